@@ -1,30 +1,76 @@
 #include <algorithm>
+#include <array>
 #include <cctype>
+#include <chrono>
+#include <csignal>
 #include <cstring>
 #include <filesystem>
 #include <fstream>
 #include <iostream>
+#include <limits>
+#include <memory>
+#include <mutex>
 #include <optional>
 #include <regex>
+#include <sstream>
 #include <stdexcept>
 #include <string>
 #include <unordered_map>
 #include <utility>
 #include <vector>
-#include "OptFission.h"
+#include "ExactSolver.h"
+#include "ParallelOpt.h"
+#include "TemperingOpt.h"
+
+namespace {
+  // Set by SIGINT/SIGTERM; the step loop polls it and stops with the best design so far.
+  volatile std::sig_atomic_t stopRequested = 0;
+
+  extern "C" void requestStop(int) {
+    stopRequested = 1;
+  }
+}
 
 class FissionApp {
+  // Steps between checks of the stop criteria, so that signals and time limits are honoured promptly.
+  static constexpr int stopCheckEvery = 256;
+
   struct CliOptions {
     int sizeX = 5;
     int sizeY = 5;
     int sizeZ = 5;
     int steps = 50000;
     int progressEvery = 5000;
+    int children = 4;
+    int threads = 1;
+    int replicas = Fission::defaultReplicas;
+    int cacheEntries = Fission::defaultCacheEntries;
     bool useNet = false;
+    bool asyncTrain = false;
+    bool checkDelta = false;
+    bool exact = false;
     bool ensureHeatNeutral = false;
     std::string goal = "power";
+    std::string evaluator = "scalar";
+    std::string engine = "climb";
+    std::string sym;
     std::string fuelName;
     std::filesystem::path fuelConfigDir;
+    std::filesystem::path heatSinkConfigDir;
+    std::string checkpointPath;
+    int checkpointEvery = 0;
+    std::string resumePath;
+    double timeLimit = 0.0;
+    double targetPower = 0.0;
+    long long stallSteps = 0;
+    double stallSeconds = 0.0;
+    std::string sweepPath;
+    std::string sweepSizes;
+    std::string sweepFuels = "all";
+    std::string sweepGoals = "all";
+    std::vector<std::string> initPaths;
+    std::string initFit = "pad";
+    std::string initMode = "random";
   };
 
   struct FuelPreset {
@@ -33,7 +79,53 @@ class FissionApp {
     double heat = 0.0;
   };
 
+  // One run of a sweep; id is its position in the spec.
+  struct SweepJob {
+    int id = 0;
+    std::array<int, 3> size{};
+    const FuelPreset *fuel = nullptr;
+    std::string goal;
+  };
+
+  // Stop criteria of one optimizer run, polled between chunks of steps.
+  class StopWatch {
+    using Clock = std::chrono::steady_clock;
+    const CliOptions &options;
+    Clock::time_point start, lastImprovement;
+    long long lastImprovementStep = 0;
+    double bestFitness;
+  public:
+    StopWatch(const CliOptions &options, double bestFitness)
+      : options(options), start(Clock::now()), lastImprovement(start), bestFitness(bestFitness) {}
+
+    double elapsed() const { return std::chrono::duration<double>(Clock::now() - start).count(); }
+    double getBestFitness() const { return bestFitness; }
+
+    // Called after steps steps in total; returns why the run should stop, or nullptr to go on.
+    const char *update(long long steps, const Fission::Engine &engine) {
+      const auto now = Clock::now();
+      if (engine.getBestFitness() > bestFitness) {
+        bestFitness = engine.getBestFitness();
+        lastImprovement = now;
+        lastImprovementStep = steps;
+      }
+      if (stopRequested)
+        return "interrupted";
+      if (options.targetPower > 0 && engine.getBest().value.avgPower >= options.targetPower)
+        return "target power reached";
+      if (options.timeLimit > 0 && std::chrono::duration<double>(now - start).count() >= options.timeLimit)
+        return "time limit reached";
+      if (options.stallSteps > 0 && steps - lastImprovementStep >= options.stallSteps)
+        return "no improvement within --stall-steps";
+      if (options.stallSeconds > 0 && std::chrono::duration<double>(now - lastImprovement).count() >= options.stallSeconds)
+        return "no improvement within --stall-seconds";
+      return nullptr;
+    }
+  };
+
   CliOptions options_;
+  // Layouts of --init files at the size they were saved at.
+  std::vector<Fission::State> layouts_;
 
   static std::string normalizeFuelKey(const std::string &name) {
     std::string out;
@@ -70,6 +162,19 @@ class FissionApp {
     return std::nullopt;
   }
 
+  static std::vector<std::string> extractStringArrayField(const std::string &obj, const std::string &field) {
+    std::vector<std::string> result;
+    const std::regex rx("\"" + field + R"(\"\s*:\s*\[([^\]]*)\])");
+    std::smatch match;
+    if (!std::regex_search(obj, match, rx) || match.size() < 2)
+      return result;
+    const std::string items = match[1].str();
+    const std::regex itemRx(R"(\"([^\"]*)\")");
+    for (std::sregex_iterator it(items.begin(), items.end(), itemRx), end; it != end; ++it)
+      result.push_back((*it)[1].str());
+    return result;
+  }
+
   static std::vector<FuelPreset> parseFuelPresets(const std::string &json) {
     std::vector<FuelPreset> fuels;
     const std::regex objRx(R"(\{[^{}]*\})");
@@ -85,6 +190,29 @@ class FissionApp {
     return fuels;
   }
 
+  static std::vector<std::string> splitList(const std::string &list) {
+    std::vector<std::string> result;
+    std::stringstream in(list);
+    for (std::string item; std::getline(in, item, ',');)
+      if (!item.empty())
+        result.push_back(item);
+    return result;
+  }
+
+  static bool parseDoubleArg(const char *raw, double &out) {
+    try {
+      std::string s(raw);
+      size_t idx = 0;
+      const double value = std::stod(s, &idx);
+      if (idx != s.size())
+        return false;
+      out = value;
+      return true;
+    } catch (...) {
+      return false;
+    }
+  }
+
   static bool parseIntArg(const char *raw, int &out) {
     try {
       std::string s(raw);
@@ -109,11 +237,17 @@ class FissionApp {
       throw std::runtime_error("Unsupported goal: " + goal + " (expected power, breeder or efficiency)");
     }
 
+    static Fission::Backend parseBackend(const std::string &backend) {
+      if (backend == "scalar")
+        return Fission::Backend::Scalar;
+      if (backend == "bitboard")
+        return Fission::Backend::Bitboard;
+      throw std::runtime_error("Unsupported evaluator: " + backend + " (expected scalar or bitboard)");
+    }
+
     static void initCoolingRates(Fission::Settings &settings) {
-      for (int i = 0; i < Fission::TileCount; ++i) {
-        settings.limit[i] = -1;
-        settings.coolingRates[i] = 0.0;
-      }
+      settings.limit.fill(-1);
+      settings.coolingRates.fill(0.0);
       settings.coolingRates[static_cast<int>(Fission::Tile::Water)] = 60;
       settings.coolingRates[static_cast<int>(Fission::Tile::Copper)] = 80;
       settings.coolingRates[static_cast<int>(Fission::Tile::Cryotheum)] = 200;
@@ -147,13 +281,38 @@ class FissionApp {
     std::cout << "Usage: fission-cmd [options]\n"
                  "Options:\n"
                  "  --size <x> <y> <z>                Core size (default: 5 5 5)\n"
-                 "  --steps <n>                       Optimizer steps (default: 50000)\n"
+                 "  --steps <n>                       Optimizer steps, 0 for no limit (default: 50000)\n"
                  "  --progress-every <n>              Print progress interval (default: 5000)\n"
+                 "  --children <n>                    Candidates evaluated per step (default: 4)\n"
+                 "  --engine <climb|tempering>        Search engine (default: climb)\n"
+                 "  --threads <n>                     Worker threads; climb runs one island per thread (default: 1)\n"
+                 "  --replicas <n>                    Tempering replicas (default: 8)\n"
+                 "  --cache-entries <n>               Evaluation cache slots, 0 disables (default: 4096)\n"
                  "  --goal <power|breeder|efficiency> Optimization goal (default: power)\n"
                  "  --fuel <name>                     Fuel name from config/fission_fuel\n"
                  "  --fuel-config-dir <path>          Override fuel config directory\n"
+                 "  --heat-sink-config-dir <path>     Override heat sink config directory\n"
                  "  --heat-neutral                    Enforce net heat <= 0\n"
                  "  --use-net                         Enable neural net mode\n"
+                 "  --async-train                     Train the net on a background thread while searching\n"
+                 "  --exact                           Search every design for the optimum instead (small cores only)\n"
+                 "  --check-delta                     Verify incremental evaluation against full runs, and the reported best fitness\n"
+                 "  --checkpoint <path>               Save the search state here periodically and at the end\n"
+                 "  --checkpoint-every <n>            Steps between checkpoints (default: progress interval)\n"
+                 "  --resume <path>                   Continue from a checkpoint written with the same options\n"
+                 "  --time-limit <s>                  Stop after this many seconds\n"
+                 "  --target-power <p>                Stop once the best design averages this many FE/t\n"
+                 "  --stall-steps <n>                 Stop after this many steps without improvement\n"
+                 "  --stall-seconds <s>               Stop after this many seconds without improvement\n"
+                 "  --init <path>                     Start from the layouts in a file, repeatable (sweep records or a bare layout)\n"
+                 "  --init-fit <tile|pad>             Fill larger cores by repeating layouts or with air (default: pad)\n"
+                 "  --init-mode <random|greedy>       Start and restart from random tiles or a constructed design (default: random)\n"
+                 "  --sweep <path>                    Run every job of a sweep file: lines of <x> <y> <z> [fuels] [goals]\n"
+                 "  --sweep-sizes <list>              Run a sweep over sizes: n, a-b (cubes) or XxYxZ, comma-separated\n"
+                 "  --sweep-fuels <list|all>          Fuels of a sweep (default: all)\n"
+                 "  --sweep-goals <list|all>          Goals of a sweep (default: all)\n"
+                 "  --evaluator <scalar|bitboard>     Full evaluation backend (default: scalar)\n"
+                 "  --sym <axes>                      Mirror-symmetric designs along any of x, y, z (e.g. xyz)\n"
                  "  --help                            Show this message\n";
   }
 
@@ -182,6 +341,38 @@ class FissionApp {
         ++i;
         continue;
       }
+      if (arg == "--children") {
+        if (i + 1 >= argc || !parseIntArg(argv[i + 1], options_.children))
+          throw std::runtime_error("Invalid --children value");
+        ++i;
+        continue;
+      }
+      if (arg == "--engine") {
+        if (i + 1 >= argc)
+          throw std::runtime_error("Missing --engine value");
+        options_.engine = argv[++i];
+        if (options_.engine != "climb" && options_.engine != "tempering")
+          throw std::runtime_error("Unsupported engine: " + options_.engine + " (expected climb or tempering)");
+        continue;
+      }
+      if (arg == "--replicas") {
+        if (i + 1 >= argc || !parseIntArg(argv[i + 1], options_.replicas))
+          throw std::runtime_error("Invalid --replicas value");
+        ++i;
+        continue;
+      }
+      if (arg == "--threads") {
+        if (i + 1 >= argc || !parseIntArg(argv[i + 1], options_.threads))
+          throw std::runtime_error("Invalid --threads value");
+        ++i;
+        continue;
+      }
+      if (arg == "--cache-entries") {
+        if (i + 1 >= argc || !parseIntArg(argv[i + 1], options_.cacheEntries))
+          throw std::runtime_error("Invalid --cache-entries value");
+        ++i;
+        continue;
+      }
       if (arg == "--goal") {
         if (i + 1 >= argc)
           throw std::runtime_error("Missing --goal value");
@@ -200,6 +391,12 @@ class FissionApp {
         options_.fuelConfigDir = argv[++i];
         continue;
       }
+      if (arg == "--heat-sink-config-dir") {
+        if (i + 1 >= argc)
+          throw std::runtime_error("Missing --heat-sink-config-dir value");
+        options_.heatSinkConfigDir = argv[++i];
+        continue;
+      }
       if (arg == "--heat-neutral") {
         options_.ensureHeatNeutral = true;
         continue;
@@ -208,29 +405,156 @@ class FissionApp {
         options_.useNet = true;
         continue;
       }
+      if (arg == "--async-train") {
+        options_.asyncTrain = true;
+        continue;
+      }
+      if (arg == "--exact") {
+        options_.exact = true;
+        continue;
+      }
+      if (arg == "--evaluator") {
+        if (i + 1 >= argc)
+          throw std::runtime_error("Missing --evaluator value");
+        options_.evaluator = argv[++i];
+        continue;
+      }
+      if (arg == "--sym") {
+        if (i + 1 >= argc)
+          throw std::runtime_error("Missing --sym value");
+        options_.sym = argv[++i];
+        if (options_.sym.find_first_not_of("xyz") != std::string::npos)
+          throw std::runtime_error("Invalid --sym value: " + options_.sym + " (expected a subset of xyz)");
+        continue;
+      }
+      if (arg == "--checkpoint") {
+        if (i + 1 >= argc)
+          throw std::runtime_error("Missing --checkpoint value");
+        options_.checkpointPath = argv[++i];
+        continue;
+      }
+      if (arg == "--checkpoint-every") {
+        if (i + 1 >= argc || !parseIntArg(argv[i + 1], options_.checkpointEvery) || options_.checkpointEvery <= 0)
+          throw std::runtime_error("Invalid --checkpoint-every value");
+        ++i;
+        continue;
+      }
+      if (arg == "--resume") {
+        if (i + 1 >= argc)
+          throw std::runtime_error("Missing --resume value");
+        options_.resumePath = argv[++i];
+        continue;
+      }
+      if (arg == "--time-limit") {
+        if (i + 1 >= argc || !parseDoubleArg(argv[i + 1], options_.timeLimit) || options_.timeLimit <= 0)
+          throw std::runtime_error("Invalid --time-limit value");
+        ++i;
+        continue;
+      }
+      if (arg == "--target-power") {
+        if (i + 1 >= argc || !parseDoubleArg(argv[i + 1], options_.targetPower) || options_.targetPower <= 0)
+          throw std::runtime_error("Invalid --target-power value");
+        ++i;
+        continue;
+      }
+      if (arg == "--stall-steps") {
+        int stallSteps = 0;
+        if (i + 1 >= argc || !parseIntArg(argv[i + 1], stallSteps) || stallSteps <= 0)
+          throw std::runtime_error("Invalid --stall-steps value");
+        options_.stallSteps = stallSteps;
+        ++i;
+        continue;
+      }
+      if (arg == "--stall-seconds") {
+        if (i + 1 >= argc || !parseDoubleArg(argv[i + 1], options_.stallSeconds) || options_.stallSeconds <= 0)
+          throw std::runtime_error("Invalid --stall-seconds value");
+        ++i;
+        continue;
+      }
+      if (arg == "--init") {
+        if (i + 1 >= argc)
+          throw std::runtime_error("Missing --init value");
+        options_.initPaths.emplace_back(argv[++i]);
+        continue;
+      }
+      if (arg == "--init-fit") {
+        if (i + 1 >= argc)
+          throw std::runtime_error("Missing --init-fit value");
+        options_.initFit = argv[++i];
+        if (options_.initFit != "tile" && options_.initFit != "pad")
+          throw std::runtime_error("Invalid --init-fit value: " + options_.initFit + " (expected tile or pad)");
+        continue;
+      }
+      if (arg == "--init-mode") {
+        if (i + 1 >= argc)
+          throw std::runtime_error("Missing --init-mode value");
+        options_.initMode = argv[++i];
+        if (options_.initMode != "random" && options_.initMode != "greedy")
+          throw std::runtime_error("Invalid --init-mode value: " + options_.initMode + " (expected random or greedy)");
+        continue;
+      }
+      if (arg == "--sweep") {
+        if (i + 1 >= argc)
+          throw std::runtime_error("Missing --sweep value");
+        options_.sweepPath = argv[++i];
+        continue;
+      }
+      if (arg == "--sweep-sizes" || arg == "--sweep-fuels" || arg == "--sweep-goals") {
+        if (i + 1 >= argc)
+          throw std::runtime_error("Missing " + arg + " value");
+        std::string &list = arg == "--sweep-sizes" ? options_.sweepSizes : arg == "--sweep-fuels" ? options_.sweepFuels : options_.sweepGoals;
+        list = argv[++i];
+        continue;
+      }
+      if (arg == "--check-delta") {
+        options_.checkDelta = true;
+        continue;
+      }
       throw std::runtime_error("Unknown option: " + arg);
     }
 
     if (options_.sizeX <= 0 || options_.sizeY <= 0 || options_.sizeZ <= 0)
       throw std::runtime_error("Core size must be positive");
-    if (options_.steps <= 0)
-      throw std::runtime_error("--steps must be positive");
+    if (options_.steps < 0)
+      throw std::runtime_error("--steps must not be negative");
+    if (options_.steps == 0 && options_.timeLimit <= 0 && options_.targetPower <= 0 && options_.stallSteps <= 0 && options_.stallSeconds <= 0)
+      throw std::runtime_error("--steps 0 needs --time-limit, --target-power, --stall-steps or --stall-seconds");
     if (options_.progressEvery <= 0)
       throw std::runtime_error("--progress-every must be positive");
+    if (options_.children <= 0)
+      throw std::runtime_error("--children must be positive");
+    if (options_.threads <= 0)
+      throw std::runtime_error("--threads must be positive");
+    if (options_.checkpointEvery == 0)
+      options_.checkpointEvery = options_.progressEvery;
+    if (options_.replicas <= 0)
+      throw std::runtime_error("--replicas must be positive");
+    if (options_.engine == "tempering" && options_.useNet)
+      throw std::runtime_error("--use-net is only supported by the climb engine");
+    if (options_.asyncTrain && !options_.useNet)
+      throw std::runtime_error("--async-train needs --use-net");
+    if (options_.cacheEntries < 0)
+      throw std::runtime_error("--cache-entries must not be negative");
+    if ((!options_.sweepPath.empty() || !options_.sweepSizes.empty()) && (!options_.checkpointPath.empty() || !options_.resumePath.empty()))
+      throw std::runtime_error("--checkpoint and --resume are not supported by sweeps");
+    if (options_.exact && (options_.useNet || !options_.checkpointPath.empty() || !options_.resumePath.empty() || !options_.initPaths.empty()
+        || !options_.sweepPath.empty() || !options_.sweepSizes.empty()))
+      throw std::runtime_error("--exact does not take --use-net, --checkpoint, --resume, --init or sweeps");
 
     return true;
   }
 
-  static std::filesystem::path resolveDefaultFuelConfigDir(const char *argv0) {
+  static std::filesystem::path resolveDefaultConfigDir(const std::string &name, const char *argv0) {
+    const std::filesystem::path dir = std::filesystem::path("config") / name;
     std::vector<std::filesystem::path> candidates = {
-      "config/fission_fuel",
-      "../config/fission_fuel",
-      "../../config/fission_fuel"
+      dir,
+      ".." / dir,
+      "../.." / dir
     };
     if (argv0 != nullptr && std::strlen(argv0) > 0) {
       const std::filesystem::path exeDir = std::filesystem::absolute(argv0).parent_path();
-      candidates.push_back(exeDir / "../config/fission_fuel");
-      candidates.push_back(exeDir / "config/fission_fuel");
+      candidates.push_back(exeDir / ".." / dir);
+      candidates.push_back(exeDir / dir);
     }
     for (const auto &candidate : candidates) {
       if (std::filesystem::exists(candidate) && std::filesystem::is_directory(candidate))
@@ -255,27 +579,310 @@ class FissionApp {
     return result;
   }
 
-  Fission::Settings buildSettings(const FuelPreset &fuel) const {
+  // Overrides the stock cooling rates and placement rules with every heat sink found in heatSinkDir.
+  // Returns false when the directory holds no heat sinks, leaving the stock ones in place.
+  static bool loadHeatSinks(const std::filesystem::path &heatSinkDir, Fission::Settings &settings) {
+    if (!std::filesystem::exists(heatSinkDir) || !std::filesystem::is_directory(heatSinkDir))
+      return false;
+    Fission::PlacementRules rules;
+    bool found = false;
+    const std::regex objRx(R"(\{[^{}]*\})");
+    for (const auto &entry : std::filesystem::directory_iterator(heatSinkDir)) {
+      if (!entry.is_regular_file() || entry.path().extension() != ".json")
+        continue;
+      const auto text = readFileText(entry.path());
+      if (!text)
+        continue;
+      for (std::sregex_iterator it(text->begin(), text->end(), objRx), end; it != end; ++it) {
+        const std::string obj = it->str();
+        const auto type = extractStringField(obj, "type");
+        const auto heat = extractNumberField(obj, "heat");
+        if (!type || !heat)
+          continue;
+        const int sink = Fission::PlacementRules::parseSinkType(*type);
+        rules.setRule(sink, extractStringArrayField(obj, "placement_rule"));
+        settings.coolingRates[sink] = *heat;
+        found = true;
+      }
+    }
+    if (!found)
+      return false;
+    rules.compile();
+    settings.placementRules = std::make_shared<const Fission::PlacementRules>(std::move(rules));
+    return true;
+  }
+
+  // Everything but the size, fuel and goal, so that a sweep parses the heat sink configs once.
+  Fission::Settings buildBaseSettings() const {
     Fission::Settings settings{};
-    settings.sizeX = options_.sizeX;
-    settings.sizeY = options_.sizeY;
-    settings.sizeZ = options_.sizeZ;
-    settings.fuelBasePower = fuel.forgeEnergy;
-    settings.fuelBaseHeat = fuel.heat;
     settings.ensureHeatNeutral = options_.ensureHeatNeutral;
-    settings.goal = parseGoal(options_.goal);
-    settings.symX = false;
-    settings.symY = false;
-    settings.symZ = false;
+    settings.symX = options_.sym.find('x') != std::string::npos;
+    settings.symY = options_.sym.find('y') != std::string::npos;
+    settings.symZ = options_.sym.find('z') != std::string::npos;
     settings.genMult = 1.0;
     settings.heatMult = 1.0;
     settings.modFEMult = 100.0;
     settings.modHeatMult = 100.0;
     settings.FEGenMult = 1.0;
     initCoolingRates(settings);
+    loadHeatSinks(options_.heatSinkConfigDir, settings);
     return settings;
   }
 
+  static Fission::Settings buildSettings(const Fission::Settings &base, const FuelPreset &fuel, const std::array<int, 3> &size, Fission::Goal goal) {
+    Fission::Settings settings = base;
+    settings.sizeX = size[0];
+    settings.sizeY = size[1];
+    settings.sizeZ = size[2];
+    settings.fuelBasePower = fuel.forgeEnergy;
+    settings.fuelBaseHeat = fuel.heat;
+    settings.goal = goal;
+    return settings;
+  }
+
+  std::unique_ptr<Fission::Engine> makeEngine(const Fission::Settings &settings, int nThreads) const {
+    std::unique_ptr<Fission::Engine> engine;
+    if (options_.engine == "tempering") {
+      engine = std::make_unique<Fission::TemperingOpt>(settings, options_.replicas, nThreads, options_.cacheEntries);
+    } else {
+      auto climb = std::make_unique<Fission::ParallelOpt>(settings, nThreads, options_.useNet, options_.children, options_.cacheEntries);
+      if (options_.asyncTrain)
+        climb->setAsyncTraining(true);
+      engine = std::move(climb);
+    }
+    engine->setDifferentialCheck(options_.checkDelta);
+    engine->setBackend(parseBackend(options_.evaluator));
+    engine->setInitMode(options_.initMode == "greedy" ? Fission::InitMode::Greedy : Fission::InitMode::Random);
+    if (!layouts_.empty()) {
+      const auto fit = options_.initFit == "tile" ? Fission::LayoutFit::Tile : Fission::LayoutFit::Pad;
+      std::vector<Fission::State> fitted;
+      for (const auto &layout : layouts_)
+        fitted.push_back(Fission::fitLayout(layout, settings.sizeX, settings.sizeY, settings.sizeZ, fit));
+      engine->setInitialLayouts(fitted);
+    }
+    return engine;
+  }
+
+  // One character per tile in Tile order: heat sinks, then cell, moderator and air.
+  static constexpr char tileChars[] = "wcyerhblmqtagnoCM.";
+
+  // Tiles row by row along z, rows separated by ',' and x layers by '/'.
+  static std::string formatLayout(const Fission::State &state, const Fission::Settings &settings) {
+    std::string result;
+    for (int x = 0; x < settings.sizeX; ++x) {
+      if (x)
+        result.push_back('/');
+      for (int y = 0; y < settings.sizeY; ++y) {
+        if (y)
+          result.push_back(',');
+        for (int z = 0; z < settings.sizeZ; ++z)
+          result.push_back(tileChars[state(x, y, z)]);
+      }
+    }
+    return result;
+  }
+
+  // Inverse of formatLayout.
+  static Fission::State parseLayout(const std::string &text) {
+    std::vector<std::vector<std::string>> layers(1, std::vector<std::string>(1));
+    for (char c : text) {
+      if (c == '/')
+        layers.emplace_back(1);
+      else if (c == ',')
+        layers.back().emplace_back();
+      else if (!std::isspace(static_cast<unsigned char>(c)))
+        layers.back().back().push_back(c);
+    }
+    const int sizeX = static_cast<int>(layers.size()), sizeY = static_cast<int>(layers[0].size()), sizeZ = static_cast<int>(layers[0][0].size());
+    if (!sizeZ)
+      throw std::runtime_error("Empty layout");
+    Fission::State state(sizeX, sizeY, sizeZ, static_cast<int>(Fission::Tile::Air), static_cast<int>(Fission::Tile::Casing));
+    for (int x = 0; x < sizeX; ++x) {
+      if (static_cast<int>(layers[x].size()) != sizeY)
+        throw std::runtime_error("Layout layers differ in size");
+      for (int y = 0; y < sizeY; ++y) {
+        if (static_cast<int>(layers[x][y].size()) != sizeZ)
+          throw std::runtime_error("Layout rows differ in length");
+        for (int z = 0; z < sizeZ; ++z) {
+          const char *tile = std::strchr(tileChars, layers[x][y][z]);
+          if (!tile || !*tile)
+            throw std::runtime_error(std::string("Unknown layout tile: ") + layers[x][y][z]);
+          state(x, y, z) = static_cast<std::uint8_t>(tile - tileChars);
+        }
+      }
+    }
+    return state;
+  }
+
+  // Every "layout" field of a file of sweep records, or the whole file as one bare layout.
+  static std::vector<Fission::State> loadLayouts(const std::string &path) {
+    const auto text = readFileText(path);
+    if (!text)
+      throw std::runtime_error("Cannot read layout file: " + path);
+    std::vector<Fission::State> layouts;
+    const std::regex layoutRx(R"rx("layout"\s*:\s*"([^"]*)")rx");
+    for (std::sregex_iterator it(text->begin(), text->end(), layoutRx), end; it != end; ++it)
+      layouts.push_back(parseLayout((*it)[1].str()));
+    if (layouts.empty())
+      layouts.push_back(parseLayout(*text));
+    return layouts;
+  }
+
+  static std::vector<std::array<int, 3>> parseSweepSizes(const std::string &list) {
+    std::vector<std::array<int, 3>> sizes;
+    const std::regex cubeRx(R"((\d+)(?:-(\d+))?)"), boxRx(R"((\d+)x(\d+)x(\d+))");
+    for (const auto &item : splitList(list)) {
+      std::smatch match;
+      if (std::regex_match(item, match, boxRx)) {
+        sizes.push_back({std::stoi(match[1]), std::stoi(match[2]), std::stoi(match[3])});
+      } else if (std::regex_match(item, match, cubeRx)) {
+        const int first = std::stoi(match[1]), last = match[2].matched ? std::stoi(match[2]) : first;
+        for (int n = first; n <= last; ++n)
+          sizes.push_back({n, n, n});
+      } else {
+        throw std::runtime_error("Invalid sweep size: " + item);
+      }
+    }
+    for (const auto &size : sizes)
+      if (size[0] <= 0 || size[1] <= 0 || size[2] <= 0)
+        throw std::runtime_error("Core size must be positive");
+    return sizes;
+  }
+
+  static std::vector<const FuelPreset *> parseSweepFuels(const std::string &list, const std::unordered_map<std::string, FuelPreset> &fuels) {
+    std::vector<const FuelPreset *> result;
+    if (list == "all" || list == "*") {
+      for (const auto &[key, fuel] : fuels)
+        result.push_back(&fuel);
+      std::sort(result.begin(), result.end(), [](const FuelPreset *a, const FuelPreset *b) { return a->name < b->name; });
+      return result;
+    }
+    for (const auto &name : splitList(list)) {
+      const auto it = fuels.find(normalizeFuelKey(name));
+      if (it == fuels.end())
+        throw std::runtime_error("Fuel not found: " + name);
+      result.push_back(&it->second);
+    }
+    return result;
+  }
+
+  static std::vector<std::string> parseSweepGoals(const std::string &list) {
+    if (list == "all" || list == "*")
+      return {"power", "breeder", "efficiency"};
+    std::vector<std::string> result = splitList(list);
+    for (const auto &goal : result)
+      parseGoal(goal);
+    return result;
+  }
+
+  // Jobs of the --sweep file followed by the cross product of --sweep-sizes, fuels and goals.
+  std::vector<SweepJob> buildSweep(const std::unordered_map<std::string, FuelPreset> &fuels) const {
+    std::vector<SweepJob> jobs;
+    auto addJobs = [&](const std::vector<std::array<int, 3>> &sizes, const std::string &fuelList, const std::string &goalList) {
+      const auto sweepFuels = parseSweepFuels(fuelList, fuels);
+      const auto sweepGoals = parseSweepGoals(goalList);
+      for (const auto &size : sizes)
+        for (const auto *fuel : sweepFuels)
+          for (const auto &goal : sweepGoals)
+            jobs.push_back(SweepJob{static_cast<int>(jobs.size()), size, fuel, goal});
+    };
+    if (!options_.sweepPath.empty()) {
+      const auto text = readFileText(options_.sweepPath);
+      if (!text)
+        throw std::runtime_error("Cannot read sweep file: " + options_.sweepPath);
+      std::istringstream lines(*text);
+      for (std::string line; std::getline(lines, line);) {
+        line = line.substr(0, line.find('#'));
+        std::istringstream fields(line);
+        std::array<int, 3> size{};
+        if (!(fields >> size[0]))
+          continue;
+        std::string fuelList = options_.sweepFuels, goalList = options_.sweepGoals;
+        if (!(fields >> size[1] >> size[2]) || size[0] <= 0 || size[1] <= 0 || size[2] <= 0)
+          throw std::runtime_error("Invalid sweep line: " + line);
+        fields >> fuelList >> goalList;
+        addJobs({size}, fuelList, goalList);
+      }
+    }
+    if (!options_.sweepSizes.empty())
+      addJobs(parseSweepSizes(options_.sweepSizes), options_.sweepFuels, options_.sweepGoals);
+    return jobs;
+  }
+
+  // Runs every job on its own single-threaded engine, --threads jobs at a time, and prints one JSON
+  // line per finished job. Jobs start largest core first, so the longest runs do not trail at the end.
+  int runSweep(const std::unordered_map<std::string, FuelPreset> &fuels) {
+    const Fission::Settings base = buildBaseSettings();
+    std::vector<SweepJob> jobs = buildSweep(fuels);
+    if (jobs.empty())
+      throw std::runtime_error("Sweep has no jobs");
+    std::stable_sort(jobs.begin(), jobs.end(), [](const SweepJob &a, const SweepJob &b) {
+      return a.size[0] * a.size[1] * a.size[2] > b.size[0] * b.size[1] * b.size[2];
+    });
+    std::cerr << "Running sweep of " << jobs.size() << " jobs on " << options_.threads << " threads\n";
+
+    std::mutex outputMutex;
+    Fission::WorkerPool pool(options_.threads);
+    pool.run(static_cast<int>(jobs.size()), [&](int index) {
+      const SweepJob &job = jobs[index];
+      if (stopRequested)
+        return;
+      const Fission::Settings settings = buildSettings(base, *job.fuel, job.size, parseGoal(job.goal));
+      const auto engine = makeEngine(settings, 1);
+      StopWatch watch(options_, engine->getBestFitness());
+      const char *stopReason = nullptr;
+      long long i = 0;
+      while (!stopReason && (!options_.steps || i < options_.steps)) {
+        long long chunk = stopCheckEvery;
+        if (options_.steps)
+          chunk = std::min<long long>(chunk, options_.steps - i);
+        engine->step(static_cast<int>(chunk));
+        i += chunk;
+        stopReason = watch.update(i, *engine);
+      }
+      const Fission::Sample &best = engine->getBest();
+      std::ostringstream record;
+      record << "{\"job\":" << job.id
+             << ",\"size\":[" << job.size[0] << ',' << job.size[1] << ',' << job.size[2] << ']'
+             << ",\"fuel\":\"" << job.fuel->name << '"'
+             << ",\"goal\":\"" << job.goal << '"'
+             << ",\"steps\":" << i
+             << ",\"seconds\":" << watch.elapsed()
+             << ",\"stop\":\"" << (stopReason ? stopReason : "steps") << '"'
+             << ",\"power\":" << best.value.power
+             << ",\"avgPower\":" << best.value.avgPower
+             << ",\"heat\":" << best.value.heat
+             << ",\"cooling\":" << best.value.cooling
+             << ",\"netHeat\":" << best.value.netHeat
+             << ",\"dutyCycle\":" << best.value.dutyCycle
+             << ",\"fuelUseRate\":" << best.value.avgBreed
+             << ",\"efficiency\":" << best.value.efficiency
+             << ",\"layout\":\"" << formatLayout(best.state, settings) << "\"}\n";
+      std::lock_guard<std::mutex> lock(outputMutex);
+      std::cout << record.str() << std::flush;
+    });
+    return 0;
+  }
+
+  // Branch and bound to the optimum; it cannot be interrupted midway, so Ctrl-C ends the process.
+  int runExact(const Fission::Settings &settings) {
+    std::signal(SIGINT, SIG_DFL);
+    std::signal(SIGTERM, SIG_DFL);
+    Fission::ExactSolver solver(settings, options_.threads);
+    const auto start = std::chrono::steady_clock::now();
+    solver.solve();
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    std::cout << "Searched " << solver.getNNodes() << " nodes and " << solver.getNLeaves()
+              << " complete designs in " << elapsed.count() << " s\n";
+    if (solver.getBestFitness() == -std::numeric_limits<double>::infinity()) {
+      std::cout << "No feasible design\n";
+      return 0;
+    }
+    printSummary(solver.getBest());
+    std::cout << "  Layout: " << formatLayout(solver.getBest().state, settings) << '\n';
+    return 0;
+  }
+
 public:
   int run(int argc, char **argv) {
     try {
@@ -283,7 +890,9 @@ public:
         return 0;
 
       if (options_.fuelConfigDir.empty())
-        options_.fuelConfigDir = resolveDefaultFuelConfigDir(argc > 0 ? argv[0] : nullptr);
+        options_.fuelConfigDir = resolveDefaultConfigDir("fission_fuel", argc > 0 ? argv[0] : nullptr);
+      if (options_.heatSinkConfigDir.empty())
+        options_.heatSinkConfigDir = resolveDefaultConfigDir("heat_sinks", argc > 0 ? argv[0] : nullptr);
 
       const auto fuels = loadFuelMap(options_.fuelConfigDir);
       if (fuels.empty()) {
@@ -291,6 +900,19 @@ public:
         return 1;
       }
 
+      for (const auto &path : options_.initPaths)
+        for (auto &layout : loadLayouts(path))
+          layouts_.push_back(std::move(layout));
+
+      std::signal(SIGINT, requestStop);
+      std::signal(SIGTERM, requestStop);
+      if (!options_.sweepPath.empty() || !options_.sweepSizes.empty()) {
+        const int result = runSweep(fuels);
+        std::signal(SIGINT, SIG_DFL);
+        std::signal(SIGTERM, SIG_DFL);
+        return result;
+      }
+
       const auto fuelKey = options_.fuelName.empty() ? fuels.begin()->first : normalizeFuelKey(options_.fuelName);
       const auto it = fuels.find(fuelKey);
       if (it == fuels.end()) {
@@ -300,25 +922,64 @@ public:
         return 1;
       }
 
-      const Fission::Settings settings = buildSettings(it->second);
+      const Fission::Settings settings = buildSettings(buildBaseSettings(), it->second, {options_.sizeX, options_.sizeY, options_.sizeZ}, parseGoal(options_.goal));
 
       std::cout << "Running optimization\n";
       std::cout << "  Fuel: " << it->second.name << " (power=" << settings.fuelBasePower << ", heat=" << settings.fuelBaseHeat << ")\n";
       std::cout << "  Size: " << settings.sizeX << "x" << settings.sizeY << "x" << settings.sizeZ << '\n';
       std::cout << "  Goal: " << options_.goal << '\n';
-      std::cout << "  Fuel config dir: " << options_.fuelConfigDir << "\n\n";
+      std::cout << "  Engine: " << (options_.exact ? "exact" : options_.engine) << " (threads=" << options_.threads << ")\n";
+      if (!options_.exact)
+        std::cout << "  Init: " << options_.initMode << '\n';
+      if (options_.useNet)
+        std::cout << "  Net: " << (options_.asyncTrain ? "background training" : "training between episodes") << '\n';
+      std::cout << "  Fuel config dir: " << options_.fuelConfigDir << '\n';
+      if (!layouts_.empty())
+        std::cout << "  Initial layouts: " << layouts_.size() << " (fit=" << options_.initFit << ")\n";
+      std::cout << "  Heat sinks: " << (settings.placementRules ? options_.heatSinkConfigDir.string() : "built-in") << "\n\n";
 
-      Fission::Opt optimizer(settings, options_.useNet);
-      for (int i = 1; i <= options_.steps; ++i) {
-        optimizer.step();
+      if (options_.exact)
+        return runExact(settings);
+
+      const auto engine = makeEngine(settings, options_.threads);
+      Fission::Engine &optimizer = *engine;
+      if (!options_.resumePath.empty()) {
+        optimizer.loadCheckpoint(options_.resumePath);
+        std::cout << "Resumed from " << options_.resumePath << '\n';
+      }
+      const bool checkpointing = !options_.checkpointPath.empty();
+      StopWatch watch(options_, optimizer.getBestFitness());
+      const char *stopReason = nullptr;
+      long long i = 0;
+      while (!stopReason && (!options_.steps || i < options_.steps)) {
+        long long chunk = std::min<long long>(stopCheckEvery, options_.progressEvery - i % options_.progressEvery);
+        if (options_.steps)
+          chunk = std::min<long long>(chunk, options_.steps - i);
+        if (checkpointing)
+          chunk = std::min<long long>(chunk, options_.checkpointEvery - i % options_.checkpointEvery);
+        optimizer.step(static_cast<int>(chunk));
+        i += chunk;
+        // The stop criteria and the summary must judge the same design.
+        if (options_.checkDelta && optimizer.getBestFitness() != Fission::Opt::rawFitness(settings, optimizer.getBest().value))
+          throw std::runtime_error("Best fitness " + std::to_string(optimizer.getBestFitness()) + " does not match the best design after step " + std::to_string(i));
+        stopReason = watch.update(i, optimizer);
         if (i % options_.progressEvery == 0) {
           std::cout << "step=" << i
-                    << " episode=" << optimizer.getNEpisode()
-                    << " stage=" << optimizer.getNStage()
-                    << " iter=" << optimizer.getNIteration() << '\n';
+                    << " elapsed=" << watch.elapsed()
+                    << " best=" << watch.getBestFitness();
+          optimizer.printProgress(std::cout);
+          std::cout << " cacheHits=" << optimizer.getCacheHits()
+                    << " cacheMisses=" << optimizer.getCacheMisses() << std::endl;
         }
+        if (checkpointing && (i % options_.checkpointEvery == 0 || i == options_.steps || stopReason))
+          optimizer.saveCheckpoint(options_.checkpointPath);
       }
+      std::signal(SIGINT, SIG_DFL);
+      std::signal(SIGTERM, SIG_DFL);
+      std::cout << "Stopped after " << i << " steps in " << watch.elapsed()
+                << " s" << (stopReason ? std::string(" (") + stopReason + ")" : std::string()) << '\n';
       printSummary(optimizer.getBest());
+      std::cout << "  Cache: " << optimizer.getCacheHits() << " hits, " << optimizer.getCacheMisses() << " misses\n";
       return 0;
     } catch (const std::exception &e) {
       std::cerr << "Error: " << e.what() << '\n';
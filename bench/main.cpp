@@ -0,0 +1,699 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <new>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include "ExactSolver.h"
+#include "FissionNet.h"
+#include "ParallelOpt.h"
+#include "TemperingOpt.h"
+
+// Every heap allocation in the process is counted, so the benchmark can show steady-state stepping is allocation-free.
+static std::atomic<std::uint64_t> allocationCount{0};
+
+void *operator new(std::size_t size) {
+  allocationCount.fetch_add(1, std::memory_order_relaxed);
+  if (void *p = std::malloc(size ? size : 1))
+    return p;
+  throw std::bad_alloc();
+}
+
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete(void *p, std::size_t) noexcept { std::free(p); }
+
+class FissionBench {
+  struct CliOptions {
+    int sizeX = 15;
+    int sizeY = 15;
+    int sizeZ = 15;
+    int iterations = 2000;
+    double cells = 0.2;
+    double moderators = 0.5;
+    unsigned seed = 1;
+    std::string evaluator = "scalar";
+    std::string sym;
+    int threads = 0;
+    int optSteps = 20000;
+    double target = 0.0;
+    double timeLimit = 60.0;
+    int feasibleTrials = 0;
+    int netSteps = 0;
+    int netPool = 4096;
+    bool exact = false;
+  };
+
+  CliOptions options_;
+  // Optimizer steps the exact solver must match or beat with --exact.
+  static constexpr int optCompareSteps = 300000;
+
+  static bool parseIntArg(const char *raw, int &out) {
+    try {
+      std::string s(raw);
+      size_t idx = 0;
+      const int value = std::stoi(s, &idx);
+      if (idx != s.size())
+        return false;
+      out = value;
+      return true;
+    } catch (...) {
+      return false;
+    }
+  }
+
+  static bool parseDoubleArg(const char *raw, double &out) {
+    try {
+      std::string s(raw);
+      size_t idx = 0;
+      const double value = std::stod(s, &idx);
+      if (idx != s.size())
+        return false;
+      out = value;
+      return true;
+    } catch (...) {
+      return false;
+    }
+  }
+
+  static void printUsage() {
+    std::cout << "Usage: fission-bench [options]\n"
+                 "Options:\n"
+                 "  --size <x> <y> <z>                Core size (default: 15 15 15)\n"
+                 "  --iterations <n>                  Full evaluations to time (default: 2000)\n"
+                 "  --cells <fraction>                Share of fuel cells in random cores (default: 0.2)\n"
+                 "  --moderators <fraction>           Share of moderators in random cores (default: 0.5)\n"
+                 "  --seed <n>                        Random seed (default: 1)\n"
+                 "  --evaluator <scalar|bitboard>     Full evaluation backend (default: scalar)\n"
+                 "  --sym <axes>                      Mirror-symmetric cores along any of x, y, z (e.g. xyz)\n"
+                 "  --threads <n>                     Also time the optimizer with 1 to n islands (default: off)\n"
+                 "  --opt-steps <n>                   Optimizer steps per island when timing (default: 20000)\n"
+                 "  --target <power>                  Also time each engine until it reaches this power (default: off)\n"
+                 "  --time-limit <seconds>            Give up on --target after this long (default: 60)\n"
+                 "  --feasible-trials <n>             Also count steps to a first feasible design per init mode over n seeds (default: off)\n"
+                 "  --net-steps <n>                   Also time n training steps and inferences of the net, and --opt-steps of search with it (default: off)\n"
+                 "  --net-pool <rows>                 Training rows the net samples from with --net-steps (default: 4096)\n"
+                 "  --exact                           Also check the exact solver against brute force and the optimizer on small cores\n"
+                 "  --help                            Show this message\n";
+  }
+
+  bool parseArgs(const int argc, char **argv) {
+    for (int i = 1; i < argc; ++i) {
+      const std::string arg = argv[i];
+      if (arg == "--help") {
+        printUsage();
+        return false;
+      }
+      if (arg == "--size") {
+        if (i + 3 >= argc || !parseIntArg(argv[i + 1], options_.sizeX) || !parseIntArg(argv[i + 2], options_.sizeY) || !parseIntArg(argv[i + 3], options_.sizeZ))
+          throw std::runtime_error("Invalid --size arguments");
+        i += 3;
+        continue;
+      }
+      if (arg == "--iterations") {
+        if (i + 1 >= argc || !parseIntArg(argv[i + 1], options_.iterations))
+          throw std::runtime_error("Invalid --iterations value");
+        ++i;
+        continue;
+      }
+      if (arg == "--cells") {
+        if (i + 1 >= argc || !parseDoubleArg(argv[i + 1], options_.cells))
+          throw std::runtime_error("Invalid --cells value");
+        ++i;
+        continue;
+      }
+      if (arg == "--moderators") {
+        if (i + 1 >= argc || !parseDoubleArg(argv[i + 1], options_.moderators))
+          throw std::runtime_error("Invalid --moderators value");
+        ++i;
+        continue;
+      }
+      if (arg == "--seed") {
+        int seed;
+        if (i + 1 >= argc || !parseIntArg(argv[i + 1], seed))
+          throw std::runtime_error("Invalid --seed value");
+        options_.seed = static_cast<unsigned>(seed);
+        ++i;
+        continue;
+      }
+      if (arg == "--evaluator") {
+        if (i + 1 >= argc)
+          throw std::runtime_error("Missing --evaluator value");
+        options_.evaluator = argv[++i];
+        continue;
+      }
+      if (arg == "--sym") {
+        if (i + 1 >= argc)
+          throw std::runtime_error("Missing --sym value");
+        options_.sym = argv[++i];
+        if (options_.sym.find_first_not_of("xyz") != std::string::npos)
+          throw std::runtime_error("Invalid --sym value: " + options_.sym + " (expected a subset of xyz)");
+        continue;
+      }
+      if (arg == "--threads") {
+        if (i + 1 >= argc || !parseIntArg(argv[i + 1], options_.threads))
+          throw std::runtime_error("Invalid --threads value");
+        ++i;
+        continue;
+      }
+      if (arg == "--opt-steps") {
+        if (i + 1 >= argc || !parseIntArg(argv[i + 1], options_.optSteps))
+          throw std::runtime_error("Invalid --opt-steps value");
+        ++i;
+        continue;
+      }
+      if (arg == "--target") {
+        if (i + 1 >= argc || !parseDoubleArg(argv[i + 1], options_.target))
+          throw std::runtime_error("Invalid --target value");
+        ++i;
+        continue;
+      }
+      if (arg == "--time-limit") {
+        if (i + 1 >= argc || !parseDoubleArg(argv[i + 1], options_.timeLimit))
+          throw std::runtime_error("Invalid --time-limit value");
+        ++i;
+        continue;
+      }
+      if (arg == "--feasible-trials") {
+        if (i + 1 >= argc || !parseIntArg(argv[i + 1], options_.feasibleTrials))
+          throw std::runtime_error("Invalid --feasible-trials value");
+        ++i;
+        continue;
+      }
+      if (arg == "--net-steps") {
+        if (i + 1 >= argc || !parseIntArg(argv[i + 1], options_.netSteps))
+          throw std::runtime_error("Invalid --net-steps value");
+        ++i;
+        continue;
+      }
+      if (arg == "--exact") {
+        options_.exact = true;
+        continue;
+      }
+      if (arg == "--net-pool") {
+        if (i + 1 >= argc || !parseIntArg(argv[i + 1], options_.netPool))
+          throw std::runtime_error("Invalid --net-pool value");
+        ++i;
+        continue;
+      }
+      throw std::runtime_error("Unknown option: " + arg);
+    }
+
+    if (options_.sizeX <= 0 || options_.sizeY <= 0 || options_.sizeZ <= 0)
+      throw std::runtime_error("Core size must be positive");
+    if (options_.iterations <= 0)
+      throw std::runtime_error("--iterations must be positive");
+    if (options_.threads < 0)
+      throw std::runtime_error("--threads must not be negative");
+    if (options_.optSteps <= 0)
+      throw std::runtime_error("--opt-steps must be positive");
+    if (options_.feasibleTrials < 0)
+      throw std::runtime_error("--feasible-trials must not be negative");
+    if (options_.netSteps < 0)
+      throw std::runtime_error("--net-steps must not be negative");
+    if (options_.netPool <= 0 || options_.netPool > Fission::nPool)
+      throw std::runtime_error("--net-pool must be between 1 and " + std::to_string(Fission::nPool));
+    if (options_.target < 0.0 || options_.timeLimit <= 0.0)
+      throw std::runtime_error("--target must not be negative and --time-limit must be positive");
+    if (options_.cells < 0.0 || options_.moderators < 0.0 || options_.cells + options_.moderators > 1.0)
+      throw std::runtime_error("--cells and --moderators must be non-negative and sum to at most 1");
+    if (options_.evaluator != "scalar" && options_.evaluator != "bitboard")
+      throw std::runtime_error("Unsupported evaluator: " + options_.evaluator + " (expected scalar or bitboard)");
+
+    return true;
+  }
+
+  Fission::Settings buildSettings() const {
+    Fission::Settings settings{};
+    settings.sizeX = options_.sizeX;
+    settings.sizeY = options_.sizeY;
+    settings.sizeZ = options_.sizeZ;
+    settings.fuelBasePower = 120.0;
+    settings.fuelBaseHeat = 50.0;
+    settings.limit.fill(-1);
+    settings.coolingRates.fill(100.0);
+    settings.goal = Fission::Goal::Power;
+    settings.genMult = 1.0;
+    settings.heatMult = 1.0;
+    settings.modFEMult = 100.0;
+    settings.modHeatMult = 100.0;
+    settings.FEGenMult = 1.0;
+    settings.symX = options_.sym.find('x') != std::string::npos;
+    settings.symY = options_.sym.find('y') != std::string::npos;
+    settings.symZ = options_.sym.find('z') != std::string::npos;
+    return settings;
+  }
+
+  // All mirror images of a tile under the symmetry axes, including the tile itself.
+  static void mirrorCoords(const Fission::Settings &settings, int x, int y, int z, Fission::Coords &coords) {
+    coords.clear();
+    for (int i = 0; i < 8; ++i) {
+      if ((i & 1 && !settings.symX) || (i & 2 && !settings.symY) || (i & 4 && !settings.symZ))
+        continue;
+      coords.emplace_back(
+        i & 1 ? settings.sizeX - x - 1 : x,
+        i & 2 ? settings.sizeY - y - 1 : y,
+        i & 4 ? settings.sizeZ - z - 1 : z);
+    }
+  }
+
+  Fission::State randomState(const Fission::Settings &settings, std::mt19937 &rng) const {
+    Fission::State state(options_.sizeX, options_.sizeY, options_.sizeZ,
+      static_cast<int>(Fission::Tile::Air), static_cast<int>(Fission::Tile::Casing));
+    std::uniform_real_distribution<> share;
+    std::uniform_int_distribution<> cooler(0, Fission::CoolerCount - 1);
+    for (int x = 0; x < options_.sizeX; ++x) {
+      for (int y = 0; y < options_.sizeY; ++y) {
+        for (int z = 0; z < options_.sizeZ; ++z) {
+          const double r = share(rng);
+          if (r < options_.cells)
+            state(x, y, z) = static_cast<int>(Fission::Tile::Cell);
+          else if (r < options_.cells + options_.moderators)
+            state(x, y, z) = static_cast<int>(Fission::Tile::Moderator);
+          else
+            state(x, y, z) = cooler(rng);
+        }
+      }
+    }
+    Fission::Coords images;
+    for (int x = 0; x < options_.sizeX; ++x)
+      for (int y = 0; y < options_.sizeY; ++y)
+        for (int z = 0; z < options_.sizeZ; ++z) {
+          mirrorCoords(settings, x, y, z, images);
+          for (const auto &[mx, my, mz] : images)
+            state(mx, my, mz) = state(x, y, z);
+        }
+    return state;
+  }
+
+  template <typename F>
+  static double ratePerSecond(int iterations, F &&f) {
+    const auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; ++i)
+      f(i);
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return iterations / elapsed.count();
+  }
+
+  void runEvaluatorBenchmark() const {
+    const Fission::Settings settings = buildSettings();
+    Fission::Evaluator evaluator(settings);
+    evaluator.setBackend(options_.evaluator == "bitboard" ? Fission::Backend::Bitboard : Fission::Backend::Scalar);
+    evaluator.setSymmetric(!options_.sym.empty());
+    std::mt19937 rng(options_.seed);
+    std::vector<Fission::State> states;
+    for (int i = 0; i < 16; ++i)
+      states.emplace_back(randomState(settings, rng));
+
+    Fission::Evaluation result{};
+    double checksum = 0.0;
+    const double fullRate = ratePerSecond(options_.iterations, [&](int i) {
+      evaluator.run(states[i % states.size()], result);
+      checksum += result.power;
+    });
+
+    // Sizes with compile-time specialized passes are also timed through the generic ones.
+    const bool specialized = evaluator.isSpecialized() && options_.evaluator == "scalar";
+    double genericRate = 0.0;
+    if (specialized) {
+      evaluator.setSpecialization(false);
+      genericRate = ratePerSecond(options_.iterations, [&](int i) {
+        evaluator.run(states[i % states.size()], result);
+        checksum += result.power;
+      });
+      evaluator.setSpecialization(true);
+    }
+
+    // Single-tile mutations of one layout through the incremental path.
+    Fission::Evaluation base{}, mutated{};
+    Fission::State current(states.front());
+    evaluator.run(current, base);
+    std::uniform_int_distribution<> xDist(0, options_.sizeX - 1), yDist(0, options_.sizeY - 1), zDist(0, options_.sizeZ - 1);
+    std::uniform_int_distribution<> tileDist(0, static_cast<int>(Fission::Tile::Air));
+    Fission::Coords changed;
+    const int deltaIterations = options_.iterations * 16;
+    const double deltaRate = ratePerSecond(deltaIterations, [&](int) {
+      const int x = xDist(rng), y = yDist(rng), z = zDist(rng);
+      const int oldTile = current(x, y, z), newTile = tileDist(rng);
+      mirrorCoords(settings, x, y, z, changed);
+      for (const auto &[mx, my, mz] : changed)
+        current(mx, my, mz) = newTile;
+      evaluator.applyDelta(states.front(), base, current, changed, mutated);
+      for (const auto &[mx, my, mz] : changed)
+        current(mx, my, mz) = oldTile;
+      checksum += mutated.power;
+    });
+
+    std::cout << "evaluator=" << options_.evaluator
+              << " size=" << options_.sizeX << "x" << options_.sizeY << "x" << options_.sizeZ
+              << " cells=" << options_.cells << " moderators=" << options_.moderators
+              << " sym=" << (options_.sym.empty() ? "none" : options_.sym) << '\n';
+    std::cout << "  full" << (specialized ? " (specialized)" : "") << ": " << fullRate << " evals/s\n";
+    if (specialized)
+      std::cout << "  full (generic): " << genericRate << " evals/s\n";
+    std::cout << "  delta: " << deltaRate << " evals/s\n";
+    std::cout << "  checksum: " << checksum << '\n';
+  }
+
+  // Total optimizer throughput for doubling island counts; near-linear growth means the islands scale.
+  void runOptimizerBenchmark() const {
+    const Fission::Settings settings = buildSettings();
+    const Fission::Backend backend = options_.evaluator == "bitboard" ? Fission::Backend::Bitboard : Fission::Backend::Scalar;
+    std::cout << "optimizer steps=" << options_.optSteps << " per island\n";
+    double singleRate = 0.0;
+    for (int islands = 1;; islands = std::min(islands * 2, options_.threads)) {
+      Fission::ParallelOpt optimizer(settings, islands, false);
+      optimizer.setBackend(backend);
+      // Warm up first, so that scratch buffers have reached their final sizes.
+      optimizer.step(256);
+      const std::uint64_t allocationsBefore = allocationCount.load();
+      const auto start = std::chrono::steady_clock::now();
+      optimizer.step(options_.optSteps);
+      const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+      const std::uint64_t allocations = allocationCount.load() - allocationsBefore;
+      const double rate = static_cast<double>(islands) * options_.optSteps / elapsed.count();
+      if (islands == 1)
+        singleRate = rate;
+      std::cout << "  islands=" << islands << ": " << rate << " steps/s (speedup " << rate / singleRate << ", "
+                << allocations << " allocations)\n";
+      if (islands == options_.threads)
+        break;
+    }
+  }
+
+  // Wall time each search engine needs to reach the target power, on the same thread count.
+  void runTargetBenchmark() const {
+    const Fission::Settings settings = buildSettings();
+    const Fission::Backend backend = options_.evaluator == "bitboard" ? Fission::Backend::Bitboard : Fission::Backend::Scalar;
+    const int threads = std::max(1, options_.threads);
+    std::cout << "time to power " << options_.target << " (threads=" << threads << ", limit " << options_.timeLimit << " s)\n";
+    for (const std::string engineName : {"climb", "tempering"}) {
+      std::unique_ptr<Fission::Engine> engine;
+      if (engineName == "tempering")
+        engine = std::make_unique<Fission::TemperingOpt>(settings, Fission::defaultReplicas, threads);
+      else
+        engine = std::make_unique<Fission::ParallelOpt>(settings, threads, false);
+      engine->setBackend(backend);
+      const auto start = std::chrono::steady_clock::now();
+      std::chrono::duration<double> elapsed{};
+      int steps = 0;
+      while (engine->getBestFitness() < options_.target && elapsed.count() < options_.timeLimit) {
+        engine->step(256);
+        steps += 256;
+        elapsed = std::chrono::steady_clock::now() - start;
+      }
+      std::cout << "  " << engineName << ": ";
+      if (engine->getBestFitness() >= options_.target)
+        std::cout << elapsed.count() << " s";
+      else
+        std::cout << "not reached";
+      std::cout << " (" << steps << " steps, best " << engine->getBestFitness() << ")\n";
+    }
+  }
+
+  // Steps and wall time, restarts included, until the climber holds a first feasible design, per init mode.
+  // Heat-positive designs are feasible almost from the start, so this asks for heat-neutral ones.
+  void runFeasibleBenchmark() const {
+    Fission::Settings settings = buildSettings();
+    settings.ensureHeatNeutral = true;
+    const Fission::Backend backend = options_.evaluator == "bitboard" ? Fission::Backend::Bitboard : Fission::Backend::Scalar;
+    std::cout << "steps to first heat-neutral design (" << options_.feasibleTrials << " seeds, limit " << options_.optSteps << " steps)\n";
+    const std::pair<const char *, Fission::InitMode> modes[] = {{"random", Fission::InitMode::Random}, {"greedy", Fission::InitMode::Greedy}};
+    for (const auto &[name, mode] : modes) {
+      long long totalSteps = 0;
+      double totalSeconds = 0.0;
+      int reached = 0;
+      for (int trial = 0; trial < options_.feasibleTrials; ++trial) {
+        const auto start = std::chrono::steady_clock::now();
+        Fission::Opt opt(settings, false, 4, Fission::defaultCacheEntries, options_.seed + trial);
+        opt.setBackend(backend);
+        opt.setInitMode(mode);
+        int steps = 0;
+        while (opt.getBestFitness() <= 0.0 && steps < options_.optSteps) {
+          opt.step();
+          ++steps;
+        }
+        const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        if (opt.getBestFitness() > 0.0) {
+          ++reached;
+          totalSteps += steps;
+          totalSeconds += elapsed.count();
+        }
+      }
+      std::cout << "  " << name << ": ";
+      if (reached)
+        std::cout << static_cast<double>(totalSteps) / reached << " steps, " << totalSeconds / reached << " s";
+      else
+        std::cout << "not reached";
+      std::cout << " (reached " << reached << "/" << options_.feasibleTrials << ")\n";
+    }
+  }
+
+  // Training steps and single-sample inferences of the value net, on a pool of rows from random evaluated cores.
+  // A pool far larger than the caches shows the cost of gathering minibatches from it.
+  void runNetBenchmark() const {
+    const Fission::Settings settings = buildSettings();
+    Fission::Opt opt(settings, false, 4, Fission::defaultCacheEntries, options_.seed);
+    Fission::Net net(opt);
+    Fission::Evaluator evaluator(settings);
+    evaluator.setSymmetric(!options_.sym.empty());
+    std::mt19937 rng(options_.seed);
+    std::vector<Fission::Sample> samples(64);
+    const double maxPower = settings.fuelBasePower * options_.sizeX * options_.sizeY * options_.sizeZ;
+    for (auto &sample : samples) {
+      sample.state = randomState(settings, rng);
+      Fission::countTiles(sample);
+      evaluator.run(sample.state, sample.value);
+    }
+    for (int row = 0; row < options_.netPool; row += 64) {
+      const Fission::Sample &sample = samples[row / 64 % samples.size()];
+      net.newTrajectory();
+      for (int i = row; i < std::min(row + 64, options_.netPool); ++i)
+        net.appendTrajectory(sample);
+      net.finishTrajectory(sample.value.power / maxPower);
+    }
+
+    net.train();
+    double firstLoss = 0.0, lastLoss = 0.0;
+    const std::uint64_t allocationsBefore = allocationCount.load();
+    const double trainRate = ratePerSecond(options_.netSteps, [&](int i) {
+      lastLoss = net.train();
+      if (!i)
+        firstLoss = lastLoss;
+    });
+    const std::uint64_t allocations = allocationCount.load() - allocationsBefore;
+    double checksum = 0.0;
+    const double inferRate = ratePerSecond(options_.netSteps * 16, [&](int i) {
+      checksum += net.infer(samples[i % samples.size()]);
+    });
+    // Scoring the children of one optimizer step at a time, as the inference stage does.
+    const int nChildren = 4;
+    double scores[nChildren];
+    Fission::Opt batchOpt(settings, false, nChildren, Fission::defaultCacheEntries, options_.seed);
+    Fission::Net batchNet(batchOpt);
+    const double batchRate = nChildren * ratePerSecond(options_.netSteps * 4, [&](int i) {
+      for (int j = 0; j < nChildren; ++j)
+        batchNet.setInferRow(j, samples[(i * nChildren + j) % samples.size()]);
+      batchNet.inferBatch(nChildren, scores);
+      checksum += scores[0];
+    });
+
+    std::cout << "net steps=" << options_.netSteps << " batch=" << Fission::nMiniBatch << '\n';
+    std::cout << "  pool: " << net.getPoolRows() << " rows, " << net.getPoolBytes() << " bytes ("
+              << static_cast<double>(net.getPoolBytes()) / net.getPoolRows() << " per row)\n";
+    std::cout << "  train: " << trainRate << " steps/s (loss " << firstLoss << " -> " << lastLoss << ", "
+              << allocations << " allocations)\n";
+    std::cout << "  infer: " << inferRate << " samples/s\n";
+    std::cout << "  infer (batches of " << nChildren << "): " << batchRate << " samples/s (checksum " << checksum << ")\n";
+
+    // The search itself, training between episodes or on a background thread. Steps include training
+    // steps in the former, and the longest stretch of 256 steps shows the stalls they cause.
+    for (const bool async : {false, true}) {
+      Fission::Opt search(settings, true, nChildren, Fission::defaultCacheEntries, options_.seed);
+      if (async)
+        search.setAsyncTraining(true);
+      double longest = 0.0;
+      const auto start = std::chrono::steady_clock::now();
+      int steps = 0;
+      for (; steps < options_.optSteps; steps += 256) {
+        const auto chunkStart = std::chrono::steady_clock::now();
+        for (int i = 0; i < 256; ++i)
+          search.step();
+        const std::chrono::duration<double, std::milli> chunk = std::chrono::steady_clock::now() - chunkStart;
+        longest = std::max(longest, chunk.count());
+      }
+      const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+      std::cout << "  search (" << (async ? "background training" : "training between episodes") << "): "
+                << steps / elapsed.count() << " steps/s, longest 256 steps " << longest << " ms (best "
+                << search.getBestFitness() << ")\n";
+    }
+  }
+
+  // Best fitness over every design of the fundamental domain without invalid tiles, by trying all of them.
+  static double bruteForce(const Fission::Settings &settings) {
+    std::vector<Fission::Coords> slots;
+    for (int x = settings.symX ? settings.sizeX / 2 : 0; x < settings.sizeX; ++x)
+      for (int y = settings.symY ? settings.sizeY / 2 : 0; y < settings.sizeY; ++y)
+        for (int z = settings.symZ ? settings.sizeZ / 2 : 0; z < settings.sizeZ; ++z) {
+          slots.emplace_back();
+          mirrorCoords(settings, x, y, z, slots.back());
+          // Tiles on a mirror plane are their own image and count once against the limits.
+          std::sort(slots.back().begin(), slots.back().end());
+          slots.back().erase(std::unique(slots.back().begin(), slots.back().end()), slots.back().end());
+        }
+    Fission::Evaluator evaluator(settings);
+    evaluator.setSymmetric(settings.symX || settings.symY || settings.symZ);
+    Fission::State state(settings.sizeX, settings.sizeY, settings.sizeZ,
+      static_cast<int>(Fission::Tile::Air), static_cast<int>(Fission::Tile::Casing));
+    Fission::Evaluation value;
+    std::vector<int> tiles(slots.size());
+    double best = -std::numeric_limits<double>::infinity();
+    constexpr int nTiles = static_cast<int>(Fission::Tile::Air) + 1;
+    while (true) {
+      std::array<int, Fission::TileCount> used{};
+      bool withinLimits = true;
+      for (std::size_t slot = 0; slot < slots.size(); ++slot) {
+        for (const auto &[x, y, z] : slots[slot])
+          state(x, y, z) = tiles[slot];
+        if (tiles[slot] < Fission::TileCount) {
+          used[tiles[slot]] += static_cast<int>(slots[slot].size());
+          const int limit = settings.limit[tiles[slot]];
+          withinLimits = withinLimits && (limit < 0 || used[tiles[slot]] <= limit);
+        }
+      }
+      if (withinLimits) {
+        evaluator.run(state, value);
+        if (value.invalidTiles.empty() && Fission::Opt::feasible(settings, value))
+          best = std::max(best, Fission::Opt::rawFitness(settings, value));
+      }
+      std::size_t slot = 0;
+      for (; slot < slots.size() && ++tiles[slot] == nTiles; ++slot)
+        tiles[slot] = 0;
+      if (slot == slots.size())
+        return best;
+    }
+  }
+
+  // The exact solver against brute force on cores of a few tiles, with and without the design it
+  // starts from, and against the optimizer on cores too large for brute force; false on a mismatch.
+  bool runExactBenchmark() const {
+    struct Case {
+      int sizeX, sizeY, sizeZ;
+      const char *sym;
+      Fission::Goal goal;
+      bool heatNeutral, limited;
+    };
+    auto caseSettings = [this](const Case &c) {
+      Fission::Settings settings = buildSettings();
+      settings.sizeX = c.sizeX;
+      settings.sizeY = c.sizeY;
+      settings.sizeZ = c.sizeZ;
+      settings.symX = std::string(c.sym).find('x') != std::string::npos;
+      settings.symY = std::string(c.sym).find('y') != std::string::npos;
+      settings.symZ = std::string(c.sym).find('z') != std::string::npos;
+      settings.goal = c.goal;
+      settings.ensureHeatNeutral = c.heatNeutral;
+      // Distinct rates, so that which heat sink goes where matters.
+      for (int sink = 0; sink < Fission::CoolerCount; ++sink)
+        settings.coolingRates[sink] = 40.0 + 10.0 * sink;
+      // One of each heat sink, so that the best ones run out.
+      if (c.limited)
+        std::fill_n(settings.limit.begin(), Fission::CoolerCount, 1);
+      return settings;
+    };
+    auto describe = [](const Case &c) {
+      std::string name = std::to_string(c.sizeX) + "x" + std::to_string(c.sizeY) + "x" + std::to_string(c.sizeZ);
+      if (*c.sym)
+        name += std::string(" sym ") + c.sym;
+      name += c.goal == Fission::Goal::Breeder ? " breeder" : " power";
+      if (c.heatNeutral)
+        name += " heat-neutral";
+      if (c.limited)
+        name += " limited";
+      return name;
+    };
+    auto solve = [](const Fission::Settings &settings, int seedSteps, double &seconds) {
+      const auto start = std::chrono::steady_clock::now();
+      Fission::ExactSolver solver(settings, 1, seedSteps);
+      solver.solve();
+      seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+      return solver.getBestFitness();
+    };
+
+    bool ok = true;
+    std::cout << "exact solver against brute force\n";
+    const Case bruteCases[] = {
+      {2, 2, 1, "", Fission::Goal::Power, false, false},
+      {2, 2, 1, "", Fission::Goal::Power, false, true},
+      {3, 3, 1, "xy", Fission::Goal::Power, false, false},
+      {2, 2, 2, "z", Fission::Goal::Power, true, false},
+      {3, 2, 2, "yz", Fission::Goal::Breeder, false, false},
+      {1, 1, 5, "", Fission::Goal::Power, false, false}};
+    for (const Case &c : bruteCases) {
+      const Fission::Settings settings = caseSettings(c);
+      const auto start = std::chrono::steady_clock::now();
+      const double expected = bruteForce(settings);
+      const double bruteSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+      double seconds, seededSeconds;
+      const double unseeded = solve(settings, 0, seconds), seeded = solve(settings, Fission::exactSeedSteps, seededSeconds);
+      const bool match = unseeded == expected && seeded == expected;
+      ok = ok && match;
+      std::cout << "  " << describe(c) << ": brute force " << expected << " (" << bruteSeconds << " s), exact "
+                << unseeded << " (" << seconds << " s), seeded " << seeded << " (" << seededSeconds << " s)"
+                << (match ? "" : "  MISMATCH") << '\n';
+    }
+
+    std::cout << "exact solver against " << optCompareSteps << " optimizer steps\n";
+    const Case optCases[] = {
+      {2, 2, 2, "", Fission::Goal::Power, false, false},
+      {2, 2, 3, "", Fission::Goal::Power, false, false},
+      {3, 3, 3, "xyz", Fission::Goal::Power, false, false}};
+    for (const Case &c : optCases) {
+      const Fission::Settings settings = caseSettings(c);
+      Fission::Opt opt(settings, false, 4, Fission::defaultCacheEntries, options_.seed);
+      for (int i = 0; i < optCompareSteps; ++i)
+        opt.step();
+      double seconds;
+      const double exact = solve(settings, Fission::exactSeedSteps, seconds);
+      const bool match = exact >= opt.getBestFitness();
+      ok = ok && match;
+      std::cout << "  " << describe(c) << ": optimizer " << opt.getBestFitness() << ", exact " << exact
+                << " (" << seconds << " s)" << (match ? "" : "  MISMATCH") << '\n';
+    }
+    return ok;
+  }
+
+public:
+  int run(int argc, char **argv) {
+    try {
+      if (!parseArgs(argc, argv))
+        return 0;
+      runEvaluatorBenchmark();
+      if (options_.threads > 0)
+        runOptimizerBenchmark();
+      if (options_.target > 0.0)
+        runTargetBenchmark();
+      if (options_.feasibleTrials > 0)
+        runFeasibleBenchmark();
+      if (options_.netSteps > 0)
+        runNetBenchmark();
+      if (options_.exact && !runExactBenchmark())
+        return 1;
+      return 0;
+    } catch (const std::exception &e) {
+      std::cerr << "Error: " << e.what() << '\n';
+      printUsage();
+      return 1;
+    }
+  }
+};
+
+int main(int argc, char **argv) {
+  FissionBench bench;
+  return bench.run(argc, argv);
+}
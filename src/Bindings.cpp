@@ -19,7 +19,14 @@ static void setGoal(Fission::Settings &x, int goal) {
 }
 
 static emscripten::val getData(const Fission::Sample &x) {
-  return emscripten::val(emscripten::typed_memory_view(x.state.size(), x.state.data()));
+  // The padded state is exposed as a dense copy without its casing border.
+  std::vector<std::uint8_t> data;
+  data.reserve(x.state.shape(0) * x.state.shape(1) * x.state.shape(2));
+  for (int i{}; i < x.state.shape(0); ++i)
+    for (int j{}; j < x.state.shape(1); ++j)
+      for (int k{}; k < x.state.shape(2); ++k)
+        data.emplace_back(x.state(i, j, k));
+  return emscripten::val(emscripten::typed_memory_view(data.size(), data.data())).call<emscripten::val>("slice");
 }
 
 static int getShape(const Fission::Sample &x, int i) {
@@ -27,7 +34,7 @@ static int getShape(const Fission::Sample &x, int i) {
 }
 
 static int getStride(const Fission::Sample &x, int i) {
-  return x.state.strides()[i];
+  return i == 0 ? x.state.shape(1) * x.state.shape(2) : i == 1 ? x.state.shape(2) : 1;
 }
 
 static double getPower(const Fission::Sample &x) {
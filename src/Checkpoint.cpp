@@ -0,0 +1,136 @@
+#include "Checkpoint.h"
+#include <cstring>
+#include <filesystem>
+#include <sstream>
+#include <stdexcept>
+
+namespace Fission {
+  namespace {
+    constexpr char magic[8]{'F', 'I', 'S', 'S', 'C', 'K', 'P', 'T'};
+
+    // FNV-1a over every setting that changes what a sample evaluates to.
+    std::uint64_t fingerprint(const Settings &settings) {
+      std::uint64_t result(0xcbf29ce484222325ull);
+      auto mix([&](const auto &x) {
+        const unsigned char *bytes(reinterpret_cast<const unsigned char *>(&x));
+        for (std::size_t i{}; i < sizeof(x); ++i) {
+          result ^= bytes[i];
+          result *= 0x100000001b3ull;
+        }
+      });
+      mix(settings.sizeX);
+      mix(settings.sizeY);
+      mix(settings.sizeZ);
+      mix(settings.fuelBasePower);
+      mix(settings.fuelBaseHeat);
+      mix(settings.limit);
+      mix(settings.coolingRates);
+      mix(settings.ensureHeatNeutral);
+      mix(settings.goal);
+      mix(settings.symX);
+      mix(settings.symY);
+      mix(settings.symZ);
+      mix(settings.genMult);
+      mix(settings.heatMult);
+      mix(settings.modFEMult);
+      mix(settings.modHeatMult);
+      mix(settings.FEGenMult);
+      if (settings.placementRules)
+        for (int sink{}; sink < CoolerCount; ++sink)
+          for (auto term(settings.placementRules->begin(sink)); term != settings.placementRules->end(sink); ++term)
+            mix(*term);
+      return result;
+    }
+  }
+
+  CheckpointWriter::CheckpointWriter(const std::string &path, CheckpointKind kind, const Settings &settings)
+    :path(path), tempPath(path + ".tmp"), out(tempPath, std::ios::binary | std::ios::trunc), offset(), committed() {
+    if (!out)
+      throw std::runtime_error("Cannot write checkpoint: " + tempPath);
+    raw(magic, sizeof(magic));
+    value(checkpointVersion);
+    value(kind);
+    value(fingerprint(settings));
+  }
+
+  CheckpointWriter::~CheckpointWriter() {
+    if (committed)
+      return;
+    out.close();
+    std::error_code error;
+    std::filesystem::remove(tempPath, error);
+  }
+
+  void CheckpointWriter::raw(const void *data, std::size_t bytes) {
+    out.write(static_cast<const char *>(data), static_cast<std::streamsize>(bytes));
+    offset += bytes;
+  }
+
+  void CheckpointWriter::align() {
+    static const char padding[checkpointAlignment]{};
+    raw(padding, (checkpointAlignment - offset % checkpointAlignment) % checkpointAlignment);
+  }
+
+  void CheckpointWriter::arrayHeader(std::uint64_t count) {
+    value(count);
+    align();
+  }
+
+  void CheckpointWriter::random(const std::mt19937 &rng) {
+    std::ostringstream text;
+    text << rng;
+    std::string state(text.str());
+    array(state.data(), state.size());
+  }
+
+  void CheckpointWriter::commit() {
+    out.close();
+    if (!out)
+      throw std::runtime_error("Failed writing checkpoint: " + tempPath);
+    std::filesystem::rename(tempPath, path);
+    committed = true;
+  }
+
+  CheckpointReader::CheckpointReader(const std::string &path, CheckpointKind kind, const Settings &settings)
+    :path(path), in(path, std::ios::binary), offset() {
+    if (!in)
+      throw std::runtime_error("Cannot read checkpoint: " + path);
+    char header[sizeof(magic)];
+    raw(header, sizeof(header));
+    expect(!std::memcmp(header, magic, sizeof(magic)), "file type");
+    expect(value<std::uint32_t>() == checkpointVersion, "format version");
+    expect(value<CheckpointKind>() == kind, "optimizer kind");
+    expect(value<std::uint64_t>() == fingerprint(settings), "settings");
+  }
+
+  void CheckpointReader::raw(void *data, std::size_t bytes) {
+    in.read(static_cast<char *>(data), static_cast<std::streamsize>(bytes));
+    expect(static_cast<bool>(in), "length");
+    offset += bytes;
+  }
+
+  void CheckpointReader::align() {
+    std::size_t padding((checkpointAlignment - offset % checkpointAlignment) % checkpointAlignment);
+    in.seekg(static_cast<std::streamoff>(padding), std::ios::cur);
+    offset += padding;
+  }
+
+  std::uint64_t CheckpointReader::arrayHeader() {
+    std::uint64_t count(value<std::uint64_t>());
+    align();
+    return count;
+  }
+
+  void CheckpointReader::random(std::mt19937 &rng) {
+    std::string state(arrayHeader(), '\0');
+    raw(state.data(), state.size());
+    std::istringstream text(state);
+    text >> rng;
+    expect(!text.fail(), "random state");
+  }
+
+  void CheckpointReader::expect(bool ok, const char *what) const {
+    if (!ok)
+      throw std::runtime_error("Checkpoint " + path + " does not match (" + what + ")");
+  }
+}
@@ -0,0 +1,91 @@
+#ifndef _CHECKPOINT_H_
+#define _CHECKPOINT_H_
+#include <fstream>
+#include <random>
+#include <string>
+#include <type_traits>
+#include "Fission.h"
+
+namespace Fission {
+  enum class CheckpointKind : std::uint32_t {
+    Opt,
+    Islands,
+    Tempering
+  };
+
+  // Versioned binary checkpoint files. A fixed header names the format version, the kind of
+  // optimizer and a fingerprint of the settings it ran with; the payload follows in the order
+  // the optimizer writes it. Values are stored in host byte order, which is little-endian on
+  // every supported target. Bulk arrays are prefixed with their element count and start on
+  // a 64-byte file offset; each is read straight into its destination in one call.
+  constexpr std::uint32_t checkpointVersion(2);
+  constexpr int checkpointAlignment(64);
+
+  class CheckpointWriter {
+    std::string path, tempPath;
+    std::ofstream out;
+    std::uint64_t offset;
+    bool committed;
+    void align();
+  public:
+    // Writes to a temporary file next to path; commit replaces path with it. A writer destroyed
+    // before it commits, as when saving throws, removes the temporary file and leaves path alone.
+    CheckpointWriter(const std::string &path, CheckpointKind kind, const Settings &settings);
+    ~CheckpointWriter();
+    void raw(const void *data, std::size_t bytes);
+
+    template <typename T>
+    void value(const T &x) {
+      static_assert(std::is_trivially_copyable_v<T>);
+      raw(&x, sizeof(x));
+    }
+
+    // Element count, padding to the next aligned offset, then the elements.
+    void arrayHeader(std::uint64_t count);
+
+    template <typename T>
+    void array(const T *data, std::size_t count) {
+      static_assert(std::is_trivially_copyable_v<T>);
+      arrayHeader(count);
+      raw(data, count * sizeof(T));
+    }
+
+    void random(const std::mt19937 &rng);
+    void commit();
+  };
+
+  class CheckpointReader {
+    std::string path;
+    std::ifstream in;
+    std::uint64_t offset;
+    void align();
+  public:
+    // Throws if the file is missing, of another version or kind, or written for other settings.
+    CheckpointReader(const std::string &path, CheckpointKind kind, const Settings &settings);
+    void raw(void *data, std::size_t bytes);
+
+    template <typename T>
+    T value() {
+      static_assert(std::is_trivially_copyable_v<T>);
+      T result;
+      raw(&result, sizeof(result));
+      return result;
+    }
+
+    std::uint64_t arrayHeader();
+
+    // Reads an array that must hold exactly count elements.
+    template <typename T>
+    void array(T *data, std::size_t count) {
+      static_assert(std::is_trivially_copyable_v<T>);
+      expect(arrayHeader() == count, "array size");
+      raw(data, count * sizeof(T));
+    }
+
+    void random(std::mt19937 &rng);
+    // Throws a runtime_error naming the mismatched field unless ok.
+    void expect(bool ok, const char *what) const;
+  };
+}
+
+#endif
@@ -0,0 +1,32 @@
+#ifndef _ENGINE_H_
+#define _ENGINE_H_
+#include <ostream>
+#include "OptFission.h"
+
+namespace Fission {
+  // Search strategy driven in chunks of steps by the command line front end.
+  class Engine {
+  public:
+    virtual ~Engine() = default;
+    // Advances the search by nSteps; returns once they are done.
+    virtual void step(int nSteps) = 0;
+    virtual void setDifferentialCheck(bool enabled) = 0;
+    virtual void setBackend(Backend backend) = 0;
+    // Core-sized layouts to start from instead of random tiles; call before stepping.
+    virtual void setInitialLayouts(const std::vector<State> &layouts) = 0;
+    // How the search fills the core where no layout is given; call before stepping.
+    virtual void setInitMode(InitMode mode) = 0;
+    // Best feasible sample found so far.
+    virtual const Sample &getBest() const = 0;
+    virtual double getBestFitness() const = 0;
+    virtual std::uint64_t getCacheHits() const = 0;
+    virtual std::uint64_t getCacheMisses() const = 0;
+    // Engine-specific progress as " key=value" fields.
+    virtual void printProgress(std::ostream &out) const = 0;
+    // Whole search state, written atomically; loading needs an engine built with the same arguments.
+    virtual void saveCheckpoint(const std::string &path) const = 0;
+    virtual void loadCheckpoint(const std::string &path) = 0;
+  };
+}
+
+#endif
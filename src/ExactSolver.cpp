@@ -0,0 +1,553 @@
+#include "ExactSolver.h"
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <numeric>
+
+namespace Fission {
+  namespace {
+    constexpr int Cell = static_cast<int>(Tile::Cell);
+    constexpr int Moderator = static_cast<int>(Tile::Moderator);
+    constexpr int Air = static_cast<int>(Tile::Air);
+    constexpr int Casing = static_cast<int>(Tile::Casing);
+    // Slots of the cell stage that are not decided yet.
+    constexpr int Undecided(-1);
+    constexpr double Infinity = std::numeric_limits<double>::infinity();
+    // Choices of the cell stage; air stands for a tile the sink stage fills in later.
+    constexpr int cellStageTiles[] { Cell, Moderator, Air };
+
+    // Evaluator::checkRule over neighbours that match for certain or only possibly: match(target, k)
+    // gives both for the neighbour along offset k. False only if no outcome can meet the rule.
+    template <typename Match>
+    bool ruleMayHold(const PlacementRules &rules, int sink, const Match &match) {
+      bool clause(false);
+      for (auto term(rules.begin(sink)), end(rules.end(sink)); term != end; ++term) {
+        if (!clause) {
+          std::array<bool, 6> possible;
+          int nCertain{}, nPossible{};
+          for (int k{}; k < 6; ++k) {
+            const auto [certain, maybe](match(term->target, k));
+            nCertain += certain;
+            possible[k] = certain || maybe;
+            nPossible += possible[k];
+          }
+          switch (term->requirement) {
+            case PlacementRules::Requirement::AtLeast:
+              clause = nPossible >= term->count;
+              break;
+            case PlacementRules::Requirement::Axial:
+              clause = (possible[0] && possible[1]) || (possible[2] && possible[3]) || (possible[4] && possible[5]);
+              break;
+            case PlacementRules::Requirement::Vertex:
+              clause = nCertain <= term->count && nPossible >= term->count
+                && (possible[0] || possible[1]) && (possible[2] || possible[3]) && (possible[4] || possible[5]);
+              break;
+          }
+        }
+        if (term->lastInClause) {
+          if (!clause)
+            return false;
+          clause = false;
+        }
+      }
+      return true;
+    }
+  }
+
+  ExactSolver::Worker::Worker(const Settings &settings)
+    :evaluator(settings), state(settings.sizeX, settings.sizeY, settings.sizeZ, Air, Casing),
+    limit(settings.limit), activeModerators(settings.sizeX, settings.sizeY, settings.sizeZ, false, false),
+    nNodes(), nLeaves() {
+    evaluator.setSymmetric(true);
+  }
+
+  ExactSolver::ExactSolver(const Settings &settings, int nThreads, int seedSteps)
+    :settings(settings), rules(settings.placementRules ? *settings.placementRules : PlacementRules()),
+    slotOf(settings.sizeX, settings.sizeY, settings.sizeZ, -1, -1), fixedRule(),
+    seedSteps(seedSteps), splitDepth(), bestFitness(-Infinity), nNodes(), nLeaves(), pool(nThreads) {
+    best.state = State(settings.sizeX, settings.sizeY, settings.sizeZ, Air, Casing);
+    best.hash = 0;
+    countTiles(best);
+    best.limit = settings.limit;
+    Worker(settings).evaluator.run(best.state, best.value);
+    offsets = best.state.neighborOffsets();
+
+    TranspositionTable cache(settings, 0);
+    Mutator mutator(settings, cache);
+    Coords images;
+    int totalWeight{};
+    for (int x(settings.symX ? settings.sizeX / 2 : 0); x < settings.sizeX; ++x)
+      for (int y(settings.symY ? settings.sizeY / 2 : 0); y < settings.sizeY; ++y)
+        for (int z(settings.symZ ? settings.sizeZ / 2 : 0); z < settings.sizeZ; ++z) {
+          Slot slot{x, y, z, mutator.getNSym(x, y, z), {}, {}};
+          mutator.getSymCoords(x, y, z, images);
+          for (auto const &[ix, iy, iz] : images)
+            slot.images.emplace_back(best.state.index(ix, iy, iz));
+          totalWeight += slot.weight;
+          slots.emplace_back(std::move(slot));
+        }
+    // Heavy slots first, so that the bounds learn the most about the design early on.
+    std::stable_sort(slots.begin(), slots.end(), [](const Slot &a, const Slot &b) { return a.weight > b.weight; });
+    for (int slot{}; slot < static_cast<int>(slots.size()); ++slot)
+      for (int i : slots[slot].images)
+        slotOf[i] = slot;
+    for (auto &slot : slots)
+      for (int offset : offsets) {
+        const int neighbour(slotOf[slot.images.front() + offset]);
+        if (neighbour >= 0 && std::find(slot.neighbours.begin(), slot.neighbours.end(), neighbour) == slot.neighbours.end())
+          slot.neighbours.emplace_back(neighbour);
+      }
+
+    // Sinks with negative cooling are left out, so that cooling only grows down the tree.
+    for (int sink{}; sink < CoolerCount; ++sink) {
+      if (!settings.limit[sink] || settings.coolingRates[sink] < 0.0)
+        continue;
+      sinks.emplace_back(sink);
+      fixedRule[sink] = std::all_of(rules.begin(sink), rules.end(sink), [](const PlacementRules::Term &term) {
+        return term.target == Cell || term.target == Moderator || term.target == Casing;
+      });
+    }
+    std::stable_sort(sinks.begin(), sinks.end(), [&](int a, int b) {
+      return settings.coolingRates[a] > settings.coolingRates[b];
+    });
+    maxCooling.assign(totalWeight + 1, 0.0);
+    for (int weight(1); weight <= totalWeight; ++weight) {
+      int left(weight);
+      for (int sink : sinks) {
+        const int n(settings.limit[sink] < 0 ? left : std::min(left, settings.limit[sink]));
+        maxCooling[weight] += settings.coolingRates[sink] * n;
+        left -= n;
+      }
+    }
+
+    // The heat multiplier rises to a single peak a little above one heat per cooling and falls off
+    // beyond it, so a ternary search on its unrounded form finds the peak. Below heatMult 0.05 the
+    // peak lies too far out to bound.
+    if (!(settings.heatMult >= 0.05)) {
+      maxHeatMultiplier = Infinity;
+    } else {
+      auto unrounded([&](double r) { return std::log10(r) / (1 + std::exp(r * settings.heatMult)); });
+      double low(1.0), high(100.0);
+      for (int i{}; i < 200; ++i) {
+        const double a(low + (high - low) / 3), b(high - (high - low) / 3);
+        if (unrounded(a) < unrounded(b))
+          low = a;
+        else
+          high = b;
+      }
+      maxHeatMultiplier = Evaluation::heatMultiplier((low + high) / 2, 1.0, settings.heatMult);
+    }
+    genFactor = settings.FEGenMult / 10.0 * settings.genMult;
+    // The cell bound counts on moderators adding to energy and heat, never taking away.
+    cellBound = settings.modFEMult >= 0.0 && settings.modHeatMult >= 0.0 && settings.fuelBaseHeat > 0.0
+      && (settings.goal == Goal::Breeder || (settings.goal == Goal::Power && settings.heatMult >= 0.0));
+  }
+
+  void ExactSolver::setSlot(Worker &worker, int slot, int tile) const {
+    const int weight(slots[slot].weight);
+    int &current(worker.slotTiles[slot]);
+    if (current != Air)
+      worker.limit[current] += weight;
+    if (tile != Air)
+      worker.limit[tile] -= weight;
+    current = tile;
+    for (int i : slots[slot].images)
+      worker.state[i] = tile;
+  }
+
+  int ExactSolver::decidedTile(const Worker &worker, int i, int first) const {
+    const int slot(slotOf[i]);
+    if (slot < 0)
+      return Casing;
+    return slot < first ? worker.slotTiles[slot] : Undecided;
+  }
+
+  int ExactSolver::lineEnd(const Worker &worker, int i, int offset, int &nModerators, int first) const {
+    for (;; i += offset) {
+      const int tile(decidedTile(worker, i, first));
+      if (tile == Cell || tile == Undecided)
+        return tile;
+      if (tile != Moderator || ++nModerators > 4)
+        return Air;
+    }
+  }
+
+  ExactSolver::CellBound ExactSolver::boundCell(const Worker &worker, int slot, int first) const {
+    // Each side of the cell holds a cell for sure, a moderator for sure, or may still become either.
+    // A moderator also counts the cell at the end of its line as adjacent.
+    const int i(slots[slot].images.front());
+    int aFixed{}, mFixed{}, nCellOnly{}, nEither{}, nBoth{};
+    for (int offset : offsets) {
+      const int tile(decidedTile(worker, i + offset, first));
+      int nModerators(1);
+      if (tile == Cell) {
+        ++aFixed;
+      } else if (tile == Moderator) {
+        ++mFixed;
+        const int end(lineEnd(worker, i + 2 * offset, offset, nModerators, first));
+        if (end == Cell)
+          ++aFixed;
+        else if (end == Undecided)
+          ++nCellOnly;
+      } else if (tile == Undecided) {
+        if (lineEnd(worker, i + 2 * offset, offset, nModerators, first) != Air)
+          ++nBoth;
+        else
+          ++nEither;
+      }
+    }
+    const double f(settings.modFEMult / 100.0), g(settings.modHeatMult / 100.0);
+    const int mMax(mFixed + nBoth + nEither);
+    CellBound result;
+    result.heat = (aFixed + 1) * (aFixed + 2) / 2.0 + mFixed * (aFixed + 1) * g;
+    if (settings.goal == Goal::Breeder) {
+      result.energy = 1.0;
+      result.ratio = 1.0 / result.heat;
+      return result;
+    }
+    result.energy = 0.0;
+    for (int k{}; k <= nEither; ++k)
+      result.energy = std::max(result.energy, (aFixed + nCellOnly + nBoth + k + 1) * (1.0 + (mFixed + nBoth + nEither - k) * f));
+    // Energy per heat only falls with more adjacent cells and moves one way with more moderators.
+    result.ratio = std::max((1.0 + mFixed * f) / ((aFixed + 2) / 2.0 + mFixed * g), (1.0 + mMax * f) / ((aFixed + 2) / 2.0 + mMax * g));
+    return result;
+  }
+
+  double ExactSolver::bestRate(const Worker &worker, int slot, int first) const {
+    // Undecided neighbours may become anything but casing, and air any heat sink; whether a
+    // moderator is active depends on cells yet to come.
+    const int i(slots[slot].images.front());
+    auto match([&](int target, int k) {
+      const int tile(decidedTile(worker, i + offsets[k], first));
+      if (target == Cell || target == Casing)
+        return std::make_pair(tile == target, tile == Undecided && target == Cell);
+      return std::make_pair(false, tile == Undecided || tile == (target == Moderator ? Moderator : Air));
+    });
+    for (int sink : sinks)
+      if (ruleMayHold(rules, sink, match))
+        return settings.coolingRates[sink];
+    return 0.0;
+  }
+
+  double ExactSolver::cellStageBound(Worker &worker, int first, int otherWeight) const {
+    if (!cellBound)
+      return Infinity;
+    // The fitness is at most the energy of the cells, and at most the cooling times what the cells
+    // make per heat; the undecided tiles are split between cells and heat sinks in the best way.
+    double energy{}, heat{}, ratio{}, freeRatio{}, airCooling{};
+    int freeWeight{};
+    worker.freeCells.clear();
+    worker.freeRates.clear();
+    for (int slot{}; slot < static_cast<int>(slots.size()); ++slot) {
+      const int tile(slot < first ? worker.slotTiles[slot] : Undecided), weight(slots[slot].weight);
+      if (tile == Moderator) {
+        // A moderator must still be able to end up between two cells.
+        const int i(slots[slot].images.front());
+        bool inLine(false);
+        for (int axis{}; axis < 3 && !inLine; ++axis) {
+          int nModerators(1);
+          inLine = lineEnd(worker, i + offsets[2 * axis], offsets[2 * axis], nModerators, first) != Air
+            && lineEnd(worker, i + offsets[2 * axis + 1], offsets[2 * axis + 1], nModerators, first) != Air;
+        }
+        if (!inLine)
+          return -Infinity;
+      } else if (tile == Cell) {
+        const CellBound cell(boundCell(worker, slot, first));
+        energy += cell.energy * weight;
+        heat += cell.heat * weight;
+        ratio = std::max(ratio, cell.ratio);
+      } else if (tile == Undecided) {
+        const CellBound cell(boundCell(worker, slot, first));
+        worker.freeCells.emplace_back(cell.energy, weight);
+        worker.freeRates.insert(worker.freeRates.end(), weight, bestRate(worker, slot, first));
+        freeRatio = std::max(freeRatio, cell.ratio);
+        freeWeight += weight;
+      } else {
+        airCooling += bestRate(worker, slot, first) * weight;
+      }
+    }
+    std::sort(worker.freeCells.begin(), worker.freeCells.end(), std::greater<>());
+    // Free tiles left to heat sinks cool at most at their best rates, the highest first.
+    std::sort(worker.freeRates.begin(), worker.freeRates.end(), std::greater<>());
+    double freeCooling(std::accumulate(worker.freeRates.begin(), worker.freeRates.end(), 0.0));
+    const bool breeder(settings.goal == Goal::Breeder);
+    const double scale(breeder ? 1.0 : genFactor * settings.fuelBasePower);
+    int maxCells(freeWeight);
+    if (worker.limit[Cell] >= 0)
+      maxCells = std::min(maxCells, worker.limit[Cell]);
+    // x of the free weight goes to cells, each a heat of at least one, with the most energy first.
+    double result(-Infinity);
+    auto next(worker.freeCells.cbegin());
+    int nextLeft(next == worker.freeCells.cend() ? 0 : next->second);
+    for (int x{};; ++x) {
+      if (heat > 0.0) {
+        const double cooling(std::min(maxCooling[otherWeight + freeWeight - x], airCooling + freeCooling));
+        if (!settings.ensureHeatNeutral || cooling >= heat * settings.fuelBaseHeat) {
+          // With the most energy per heat of any cell, the cooling caps the energy that runs.
+          const double perHeat(std::min(x ? std::max(ratio, freeRatio) : ratio, energy / heat));
+          double bound(breeder ? energy : energy * dutyHeatMultiplier(heat * settings.fuelBaseHeat / (cooling + 1.0)));
+          if (std::isfinite(maxHeatMultiplier) || breeder)
+            bound = std::min(bound, (breeder ? 1.0 : maxHeatMultiplier) * cooling / settings.fuelBaseHeat * perHeat);
+          result = std::max(result, scale * bound);
+        }
+      } else {
+        result = std::max(result, 0.0);
+      }
+      if (x == maxCells)
+        return result;
+      while (!nextLeft) {
+        ++next;
+        nextLeft = next->second;
+      }
+      energy += next->first;
+      heat += 1.0;
+      freeCooling -= worker.freeRates[freeWeight - x - 1];
+      --nextLeft;
+    }
+  }
+
+  double ExactSolver::dutyHeatMultiplier(double heatPerCooling) const {
+    if (settings.heatMult < 0.0)
+      return Infinity;
+    // The duty cycle is at most one over heat per cooling, and the multiplier at most one up to one
+    // heat per cooling. Beyond, it grows slower than that ratio, even with its rounding added.
+    if (heatPerCooling <= 1.0)
+      return 1.0;
+    const double unrounded(std::log10(heatPerCooling) / (1 + std::exp(heatPerCooling * settings.heatMult)) + 1);
+    return std::min(1.0, (unrounded + 0.005) / heatPerCooling);
+  }
+
+  double ExactSolver::sinkStageBound(const CellTotals &totals, double coolingMin, double coolingMax) const {
+    if (coolingMax <= 0.0 || (settings.ensureHeatNeutral && coolingMax < totals.heat))
+      return -Infinity;
+    const double heat(totals.heat), dutyCycle(coolingMax >= heat ? 1.0 : coolingMax / heat);
+    const double power(totals.power * genFactor);
+    switch (settings.goal) {
+      default: {
+        if (heat <= 0.0)
+          return 0.0;
+        // With enough cooling the multiplier only falls as cooling grows; short of it, the
+        // multiplier times the duty cycle falls as heat per cooling grows.
+        double result(-Infinity);
+        if (coolingMax >= heat)
+          result = power * Evaluation::heatMultiplier(heat, std::max(coolingMin, heat) + 1.0, settings.heatMult);
+        if (coolingMin < heat)
+          result = std::max(result, power * dutyHeatMultiplier(heat / (std::min(coolingMax, heat) + 1.0)));
+        return result;
+      }
+      case Goal::Breeder:
+        return totals.breed * dutyCycle;
+      case Goal::Efficiency: {
+        // Below one heat per cooling the multiplier grows with heat, so the least cooling gives the most.
+        const double heatMultiplier(coolingMin >= heat
+          ? Evaluation::heatMultiplier(heat, coolingMin + 1.0, settings.heatMult) : maxHeatMultiplier);
+        return totals.breed ? std::ceil(power * heatMultiplier) / (settings.fuelBasePower * totals.breed) - 1 : -1.0;
+      }
+    }
+  }
+
+  bool ExactSolver::ruleHolds(const Worker &worker, int sink, int i) const {
+    return ruleMayHold(rules, sink, [&](int target, int k) {
+      const int n(i + offsets[k]), slot(slotOf[n]);
+      const bool certain(target == Moderator ? worker.activeModerators[n] : worker.state[n] == target);
+      return std::make_pair(certain, target < Cell && slot >= 0 && worker.sinkDomains[slot] >> target & 1);
+    });
+  }
+
+  bool ExactSolver::propagate(Worker &worker, int next) const {
+    while (!worker.queue.empty()) {
+      const int changed(worker.queue.back());
+      worker.queue.pop_back();
+      for (int slot : slots[changed].neighbours) {
+        const int index(worker.sinkIndex[slot]), i(slots[slot].images.front());
+        if (index < 0)
+          continue;
+        if (index < next) {
+          const int tile(worker.slotTiles[slot]);
+          if (tile != Air && !fixedRule[tile] && !ruleHolds(worker, tile, i))
+            return false;
+          continue;
+        }
+        std::uint32_t &domain(worker.sinkDomains[slot]);
+        const std::uint32_t before(domain);
+        for (int sink : sinks)
+          if (domain >> sink & 1 && !fixedRule[sink] && !ruleHolds(worker, sink, i))
+            domain &= ~(1u << sink);
+        if (domain != before) {
+          worker.trail.emplace_back(slot, before);
+          worker.queue.emplace_back(slot);
+        }
+      }
+    }
+    return true;
+  }
+
+  double ExactSolver::coolingAfter(const Worker &worker, int index) const {
+    double result{};
+    for (int k(index); k < static_cast<int>(worker.sinkSlots.size()); ++k) {
+      const int slot(worker.sinkSlots[k]);
+      const std::uint32_t domain(worker.sinkDomains[slot]);
+      for (int sink : sinks)
+        if (domain >> sink & 1) {
+          result += settings.coolingRates[sink] * slots[slot].weight;
+          break;
+        }
+    }
+    return result;
+  }
+
+  void ExactSolver::placeCells(Worker &worker, int slot, int otherWeight) {
+    ++worker.nNodes;
+    if (cellStageBound(worker, slot, otherWeight) <= getBestFitness())
+      return;
+    if (slot == static_cast<int>(slots.size())) {
+      finishCells(worker);
+      return;
+    }
+    const int weight(slots[slot].weight);
+    for (int tile : cellStageTiles) {
+      if (tile != Air && worker.limit[tile] >= 0 && worker.limit[tile] < weight)
+        continue;
+      setSlot(worker, slot, tile);
+      placeCells(worker, slot + 1, otherWeight + (tile == Air ? weight : 0));
+    }
+    setSlot(worker, slot, Air);
+  }
+
+  void ExactSolver::finishCells(Worker &worker) {
+    worker.evaluator.run(worker.state, worker.value);
+    // A moderator out of line is invalid; the same design without it is enumerated separately.
+    if (!worker.value.invalidTiles.empty())
+      return;
+    const Evaluation &value(worker.value);
+    const CellTotals totals{
+      settings.fuelBasePower * (value.cellsEnergyMult + value.moderatorCellMultiplier * settings.modFEMult / 100.0),
+      value.heat, static_cast<double>(value.breed)};
+
+    // Moderators at either end of a line between two cells are the active ones that rules count.
+    worker.activeModerators.fill(false);
+    for (auto &slot : slots) {
+      if (worker.state[slot.images.front()] != Moderator)
+        continue;
+      for (int i : slot.images)
+        for (int offset : offsets) {
+          if (worker.state[i - offset] != Cell)
+            continue;
+          int n(i + offset), nModerators(1);
+          for (; worker.state[n] == Moderator; n += offset)
+            ++nModerators;
+          if (nModerators <= 4 && worker.state[n] == Cell)
+            worker.activeModerators[i] = true;
+        }
+    }
+
+    worker.sinkSlots.clear();
+    worker.sinkIndex.assign(slots.size(), -1);
+    worker.sinkDomains.assign(slots.size(), 0);
+    worker.queue.clear();
+    for (int slot{}; slot < static_cast<int>(slots.size()); ++slot) {
+      worker.queue.emplace_back(slot);
+      if (worker.slotTiles[slot] != Air)
+        continue;
+      worker.sinkIndex[slot] = static_cast<int>(worker.sinkSlots.size());
+      worker.sinkSlots.emplace_back(slot);
+      // Sinks whose rule only looks at cells, moderators and casing are decided by the placement;
+      // the others are narrowed down below.
+      for (int sink : sinks)
+        if (!fixedRule[sink] || ruleHolds(worker, sink, slots[slot].images.front()))
+          worker.sinkDomains[slot] |= 1u << sink;
+    }
+    // The queue holds every slot, so every slot next to a heat sink slot is checked.
+    propagate(worker, 0);
+    worker.trail.clear();
+    placeSinks(worker, totals, 0, 0.0);
+  }
+
+  void ExactSolver::placeSinks(Worker &worker, const CellTotals &totals, int index, double cooling) {
+    ++worker.nNodes;
+    if (sinkStageBound(totals, cooling, cooling + coolingAfter(worker, index)) <= getBestFitness())
+      return;
+    if (index == static_cast<int>(worker.sinkSlots.size())) {
+      ++worker.nLeaves;
+      worker.evaluator.run(worker.state, worker.value);
+      if (worker.value.invalidTiles.empty() && Opt::feasible(settings, worker.value))
+        offer(worker.state, worker.value, worker.limit, Opt::rawFitness(settings, worker.value));
+      return;
+    }
+    // Deciding a slot narrows its domain to its choice, which narrows its neighbours' in turn.
+    const int slot(worker.sinkSlots[index]), weight(slots[slot].weight);
+    const std::uint32_t domain(worker.sinkDomains[slot]);
+    const std::size_t mark(worker.trail.size());
+    auto choose([&](int tile) {
+      setSlot(worker, slot, tile);
+      worker.sinkDomains[slot] = tile == Air ? 0 : 1u << tile;
+      worker.queue.assign(1, slot);
+      if (propagate(worker, index + 1))
+        placeSinks(worker, totals, index + 1, cooling + (tile == Air ? 0.0 : settings.coolingRates[tile] * weight));
+      for (; worker.trail.size() > mark; worker.trail.pop_back())
+        worker.sinkDomains[worker.trail.back().first] = worker.trail.back().second;
+    });
+    for (int sink : sinks)
+      if (domain >> sink & 1 && (worker.limit[sink] < 0 || worker.limit[sink] >= weight))
+        choose(sink);
+    choose(Air);
+    setSlot(worker, slot, Air);
+    worker.sinkDomains[slot] = domain;
+  }
+
+  void ExactSolver::offer(const State &state, const Evaluation &value, const std::array<int, TileCount> &limit, double fitness) {
+    if (fitness <= getBestFitness())
+      return;
+    std::lock_guard<std::mutex> lock(bestMutex);
+    if (fitness <= getBestFitness())
+      return;
+    best.state = state;
+    best.value = value;
+    best.limit = limit;
+    bestFitness.store(fitness, std::memory_order_relaxed);
+  }
+
+  void ExactSolver::runTask(int task) {
+    Worker worker(settings);
+    worker.slotTiles.assign(slots.size(), Air);
+    // The task number spells the tiles of the first splitDepth slots in base 3, most significant first.
+    int otherWeight{}, place(1);
+    for (int slot{}; slot < splitDepth; ++slot)
+      place *= 3;
+    for (int slot{}; slot < splitDepth; ++slot) {
+      place /= 3;
+      const int tile(cellStageTiles[task / place % 3]), weight(slots[slot].weight);
+      if (tile != Air && worker.limit[tile] >= 0 && worker.limit[tile] < weight)
+        return;
+      setSlot(worker, slot, tile);
+      if (tile == Air)
+        otherWeight += weight;
+    }
+    placeCells(worker, splitDepth, otherWeight);
+    nNodes += worker.nNodes;
+    nLeaves += worker.nLeaves;
+  }
+
+  void ExactSolver::solve() {
+    // A design from a short search lets the bounds cut most of the tree from the start.
+    if (seedSteps) {
+      Opt opt(settings, false);
+      for (int i{}; i < seedSteps; ++i)
+        opt.step();
+      Sample seed(opt.getBest());
+      TranspositionTable cache(settings, 0);
+      Worker worker(settings);
+      Mutator(settings, cache).removeInvalidTiles(seed, worker.evaluator);
+      if (Opt::feasible(settings, seed.value))
+        offer(seed.state, seed.value, seed.limit, Opt::rawFitness(settings, seed.value));
+    }
+    // Enough subtrees that threads finishing early find more to take.
+    int nTasks(1);
+    for (splitDepth = 0; splitDepth < static_cast<int>(slots.size()) && nTasks < 64 * pool.getNThreads(); ++splitDepth)
+      nTasks *= 3;
+    pool.run(nTasks, [this](int task) { runTask(task); });
+    best.hash = TranspositionTable(settings, 0).hashOf(best.state);
+    countTiles(best);
+  }
+}
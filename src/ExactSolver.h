@@ -0,0 +1,131 @@
+#ifndef _EXACT_SOLVER_H_
+#define _EXACT_SOLVER_H_
+#include <atomic>
+#include <mutex>
+#include "OptFission.h"
+#include "WorkerPool.h"
+
+namespace Fission {
+  // Steps of the Opt run whose best design the exact search starts from.
+  constexpr int exactSeedSteps(100000);
+
+  // Branch and bound over every design of the fundamental domain without invalid tiles, which is
+  // what Opt reports once it has stripped them, so the result is the optimum Opt can reach.
+  // The first stage places cells and moderators; heat sinks never change power, heat or breed,
+  // so each complete placement knows them exactly. Only placements whose bound still beats the
+  // incumbent go on to the second stage, which fills the remaining tiles with heat sinks.
+  // The search starts from the best design of a short Opt run, so that the bounds cut from the
+  // start. The first stage bounds each cell by what its decided neighbours still allow, and
+  // splits the undecided tiles between cells and the heat sinks the limits leave. The second
+  // stage narrows the heat sinks each tile may still hold as its neighbours are decided, and
+  // bounds the heat multiplier together with the duty cycle over the cooling still reachable.
+  // The first levels of the cell stage are split into subtrees that threads take in turn.
+  // Practical for fundamental domains of up to about twenty tiles, e.g. 3x3x2 or 3x3x3 symmetric
+  // in z; domains of 27 tiles, such as 3x3x3 or 5x5x5 symmetric in xyz, still take far longer.
+  class ExactSolver {
+    struct Slot {
+      int x, y, z, weight;
+      // Padded indices of the tile and its mirror images, the tile itself first.
+      std::vector<int> images;
+      // Slots next to the tile itself, whose tiles its rule looks at; by symmetry also the slots
+      // whose rules look at this one.
+      std::vector<int> neighbours;
+    };
+
+    // Power before the heat multiplier, heat and breed of a complete cell placement.
+    struct CellTotals {
+      double power, heat, breed;
+    };
+
+    // What a cell at a slot can still make, given the slots decided so far: the most energy
+    // multiplier (or breed), the least heat multiplier, and the most of the former per the latter.
+    struct CellBound {
+      double energy, heat, ratio;
+    };
+
+    struct Worker {
+      Evaluator evaluator;
+      State state;
+      Evaluation value;
+      std::array<int, TileCount> limit;
+      std::vector<int> slotTiles;
+      // First stage: energy bounds of the undecided slots, and the best cooling rate of each of
+      // their tiles, sorted for the split between cells and heat sinks.
+      std::vector<std::pair<double, int>> freeCells;
+      std::vector<double> freeRates;
+      // Second stage: moderators next to a cell in line, which sink rules count.
+      PaddedGrid<std::uint8_t> activeModerators;
+      // Second stage: the tiles left for heat sinks in the order they are decided, the position of
+      // each slot in that order (-1 for cells and moderators), and the heat sinks each slot may
+      // still hold as a bitmask: the one chosen once decided, nothing if left air. The trail
+      // records domains as they were before each narrowing, so that backtracking restores them.
+      std::vector<int> sinkSlots, sinkIndex, queue;
+      std::vector<std::uint32_t> sinkDomains;
+      std::vector<std::pair<int, std::uint32_t>> trail;
+      std::uint64_t nNodes, nLeaves;
+      explicit Worker(const Settings &settings);
+    };
+
+    const Settings &settings;
+    PlacementRules rules;
+    std::vector<Slot> slots;
+    std::array<int, 6> offsets;
+    // Slot of every tile of the core, or -1 for casing.
+    PaddedGrid<int> slotOf;
+    // Heat sinks within the limits, highest cooling rate first.
+    std::vector<int> sinks;
+    std::array<bool, CoolerCount> fixedRule;
+    // Most cooling that heat sinks within the limits can add on any given total slot weight.
+    std::vector<double> maxCooling;
+    // Peak of the heat multiplier over any heat per cooling.
+    double maxHeatMultiplier, genFactor;
+    bool cellBound;
+    int seedSteps, splitDepth;
+    std::mutex bestMutex;
+    std::atomic<double> bestFitness;
+    Sample best;
+    std::atomic<std::uint64_t> nNodes, nLeaves;
+    WorkerPool pool;
+
+    void setSlot(Worker &worker, int slot, int tile) const;
+    // Tile at padded index i while the slots from first on are undecided: -1 if undecided.
+    int decidedTile(const Worker &worker, int i, int first) const;
+    // Tile that ends a moderator line going from i along offset: a cell, an undecided tile, or air
+    // when neither comes within reach. nModerators counts the moderators of the line so far.
+    int lineEnd(const Worker &worker, int i, int offset, int &nModerators, int first) const;
+    CellBound boundCell(const Worker &worker, int slot, int first) const;
+    // Highest cooling rate of the heat sinks whose rule may still hold at a slot.
+    double bestRate(const Worker &worker, int slot, int first) const;
+    // Bound of the designs that complete the slots before first; otherWeight is their air.
+    double cellStageBound(Worker &worker, int first, int otherWeight) const;
+    // Most the heat multiplier times the duty cycle can be at heatPerCooling or more.
+    double dutyHeatMultiplier(double heatPerCooling) const;
+    double sinkStageBound(const CellTotals &totals, double coolingMin, double coolingMax) const;
+    // Whether the rule of sink can still hold at padded index i, counting every heat sink around
+    // it as active, as they all are in a design without invalid tiles. Undecided slots may hold
+    // any sink of their domain, so a false answer rules the sink out for good.
+    bool ruleHolds(const Worker &worker, int sink, int i) const;
+    // Narrows the domains of the undecided slots around those in the queue until every sink left
+    // can still meet its rule; false if a decided sink no longer can. The second stage has decided
+    // the slots before next in its order.
+    bool propagate(Worker &worker, int next) const;
+    // Most cooling the undecided slots from index on can add with what their domains allow.
+    double coolingAfter(const Worker &worker, int index) const;
+    void placeCells(Worker &worker, int slot, int otherWeight);
+    void finishCells(Worker &worker);
+    void placeSinks(Worker &worker, const CellTotals &totals, int index, double cooling);
+    void offer(const State &state, const Evaluation &value, const std::array<int, TileCount> &limit, double fitness);
+    void runTask(int task);
+  public:
+    // With seedSteps 0 the search starts from nothing, which only takes longer.
+    explicit ExactSolver(const Settings &settings, int nThreads = 1, int seedSteps = exactSeedSteps);
+    // Searches the whole tree; getBest is the all-air core if no design is feasible.
+    void solve();
+    const Sample &getBest() const { return best; }
+    double getBestFitness() const { return bestFitness.load(std::memory_order_relaxed); }
+    std::uint64_t getNNodes() const { return nNodes; }
+    std::uint64_t getNLeaves() const { return nLeaves; }
+  };
+}
+
+#endif
@@ -1,6 +1,8 @@
+#include <algorithm>
 #include <cmath>
 #include <limits>
-#include <xtensor/xview.hpp>
+#include <stdexcept>
+#include <tuple>
 #include "Fission.h"
 
 namespace Fission {
@@ -22,9 +24,16 @@ namespace Fission {
     constexpr int Glowstone = static_cast<int>(Tile::Glowstone);
     constexpr int Cell = static_cast<int>(Tile::Cell);
     constexpr int Moderator = static_cast<int>(Tile::Moderator);
+    constexpr int Air = static_cast<int>(Tile::Air);
+    constexpr int Casing = static_cast<int>(Tile::Casing);
+    // removeInvalidTiles re-runs in full when a round clears more than one tile in this many.
+    constexpr int pruneFullRunShare(64);
   }
 
   void Evaluation::compute(const Settings &settings) {
+    cooling = 0.0;
+    for (int i{}; i < CoolerCount; ++i)
+      cooling += activeCoolers[i] * settings.coolingRates[i];
     const double moderatorsFE = moderatorCellMultiplier * settings.modFEMult / 100.0;
     const double moderatorsHeat = moderatorCellMultiplier * settings.modHeatMult / 100.0;
     heat = settings.fuelBaseHeat * (cellsHeatMult + moderatorsHeat);
@@ -60,247 +69,472 @@ namespace Fission {
   }
 
   Evaluator::Evaluator(const Settings &settings)
-    :settings(settings),
-    rules(xt::empty<int>({settings.sizeX, settings.sizeY, settings.sizeZ})),
-    isActive(xt::empty<bool>({settings.sizeX, settings.sizeY, settings.sizeZ})),
-    isModeratorInLine(xt::empty<bool>({settings.sizeX, settings.sizeY, settings.sizeZ})),
-    visited(xt::empty<bool>({settings.sizeX, settings.sizeY, settings.sizeZ})),
-    state(nullptr) {}
-
-  int Evaluator::getTileSafe(int x, int y, int z) const {
-    if (!state->in_bounds(x, y, z))
-      return -1;
-    return (*state)(x, y, z);
+    :settings(settings), placement(settings.placementRules ? *settings.placementRules : PlacementRules()),
+    stockRules(placement == PlacementRules()),
+    shape(settings.sizeX, settings.sizeY, settings.sizeZ), specializedSize(),
+    rules(settings.sizeX, settings.sizeY, settings.sizeZ, Air, Air),
+    isActive(settings.sizeX, settings.sizeY, settings.sizeZ, false, false),
+    isModeratorInLine(settings.sizeX, settings.sizeY, settings.sizeZ, false, false),
+    adjacentCells(settings.sizeX, settings.sizeY, settings.sizeZ, 0, 0),
+    state(nullptr),
+    before{nullptr, {settings.sizeX, settings.sizeY, settings.sizeZ, 0, 0}, {settings.sizeX, settings.sizeY, settings.sizeZ, false, false}},
+    after{nullptr, {settings.sizeX, settings.sizeY, settings.sizeZ, 0, 0}, {settings.sizeX, settings.sizeY, settings.sizeZ, false, false}},
+    touched(settings.sizeX, settings.sizeY, settings.sizeZ, 0, 0),
+    generation(), differentialCheck(), backend(Backend::Scalar),
+    symmetric(), folding(), domainBegin(), passBegin(),
+    symWeight(settings.sizeX, settings.sizeY, settings.sizeZ, 1, 0) {
+    placement.compile();
+    // A tile is touched at most once per delta, so this never has to grow while stepping.
+    touchedTiles.reserve(touched.size());
+    tilePass.fill(-1);
+    for (int sink{}; sink < CoolerCount; ++sink)
+      tilePass[sink] = placement.getPass(sink);
+    initializeBitboard();
+    setSpecialization(true);
   }
 
-  bool Evaluator::hasCellInLine(int x, int y, int z, int dx, int dy, int dz) {
-    for (int n{}; n <= 4; ++n) {
-      x += dx; y += dy; z += dz;
-      int tile(getTileSafe(x, y, z));
-      if (tile == Cell) {
-        for (int i{}; i < n; ++i) {
-          x -= dx; y -= dy; z -= dz;
-          isModeratorInLine(x, y, z) = true;
-        }
-        if (getTileSafe(x, y, z) == Moderator) {
-          isActive(x, y, z) = true;
+  void Evaluator::setSpecialization(bool enabled) {
+    specializedSize = 0;
+    if (enabled && settings.sizeX == settings.sizeY && settings.sizeY == settings.sizeZ)
+      for (int size : SpecializedSizes)
+        if (size == settings.sizeX)
+          specializedSize = size;
+  }
+
+  void Evaluator::setSymmetric(bool enabled) {
+    symmetric = enabled && (settings.symX || settings.symY || settings.symZ);
+    domainBegin = {
+      symmetric && settings.symX ? settings.sizeX / 2 : 0,
+      symmetric && settings.symY ? settings.sizeY / 2 : 0,
+      symmetric && settings.symZ ? settings.sizeZ / 2 : 0};
+    symWeight.fillInterior(1);
+    if (symmetric)
+      initializeSymmetry();
+  }
+
+  void Evaluator::initializeSymmetry() {
+    // Every tile folds onto its mirror image in the fundamental domain, which stands for
+    // all of its images with the same weight as Opt::getNSym; tiles outside weigh nothing.
+    fold = PaddedGrid<int>(settings.sizeX, settings.sizeY, settings.sizeZ, 0, 0);
+    for (int i{}; i < fold.size(); ++i)
+      fold[i] = i;
+    for (int x{}; x < settings.sizeX; ++x) {
+      int mx(settings.sizeX - x - 1);
+      for (int y{}; y < settings.sizeY; ++y) {
+        int my(settings.sizeY - y - 1);
+        for (int z{}; z < settings.sizeZ; ++z) {
+          int mz(settings.sizeZ - z - 1);
+          fold(x, y, z) = fold.index(x < domainBegin[0] ? mx : x, y < domainBegin[1] ? my : y, z < domainBegin[2] ? mz : z);
+          bool inside(x >= domainBegin[0] && y >= domainBegin[1] && z >= domainBegin[2]);
+          symWeight(x, y, z) = !inside ? 0 : (settings.symX && x != mx ? 2 : 1)
+            * (settings.symY && y != my ? 2 : 1) * (settings.symZ && z != mz ? 2 : 1);
         }
-        return true;
       }
-      if (tile != Moderator) return false;
     }
-    return false;
-  }
-
-  int Evaluator::countAdjFuelCells(int x, int y, int z) {
-    return hasCellInLine(x, y, z, -1, 0, 0)
-         + hasCellInLine(x, y, z, +1, 0, 0)
-         + hasCellInLine(x, y, z, 0, -1, 0)
-         + hasCellInLine(x, y, z, 0, +1, 0)
-         + hasCellInLine(x, y, z, 0, 0, -1)
-         + hasCellInLine(x, y, z, 0, 0, +1);
   }
 
-  int Evaluator::isActiveSafe(int tile, int x, int y, int z) const {
-    if (!state->in_bounds(x, y, z))
-      return false;
-    return (*state)(x, y, z) == tile && isActive(x, y, z) && (tile < Cell || tile == Moderator);
+  void Evaluator::mirrorActivity() {
+    // Tiles just outside the domain take the activity of their mirror image inside it.
+    auto &[x0, y0, z0] = passBegin;
+    if (x0)
+      for (int y(y0); y < settings.sizeY; ++y)
+        for (int z(z0); z < settings.sizeZ; ++z)
+          isActive(x0 - 1, y, z) = isActive(settings.sizeX - x0, y, z);
+    if (y0)
+      for (int x(x0); x < settings.sizeX; ++x)
+        for (int z(z0); z < settings.sizeZ; ++z)
+          isActive(x, y0 - 1, z) = isActive(x, settings.sizeY - y0, z);
+    if (z0)
+      for (int x(x0); x < settings.sizeX; ++x)
+        for (int y(y0); y < settings.sizeY; ++y)
+          isActive(x, y, z0 - 1) = isActive(x, y, settings.sizeZ - z0);
   }
 
-  int Evaluator::countActiveNeighbors(int tile, int x, int y, int z) const {
-    return
-      + isActiveSafe(tile, x - 1, y, z)
-      + isActiveSafe(tile, x + 1, y, z)
-      + isActiveSafe(tile, x, y - 1, z)
-      + isActiveSafe(tile, x, y + 1, z)
-      + isActiveSafe(tile, x, y, z - 1)
-      + isActiveSafe(tile, x, y, z + 1);
+  void Evaluator::setInvalid(TileMask &invalidTiles, int i, bool value) const {
+    if (!symmetric) {
+      invalidTiles.assign(i, value);
+      return;
+    }
+    auto [x, y, z] = symWeight.coords(i);
+    for (int k{}; k < 8; ++k) {
+      if ((k & 1 && !settings.symX) || (k & 2 && !settings.symY) || (k & 4 && !settings.symZ))
+        continue;
+      invalidTiles.assign(symWeight.index(
+        k & 1 ? settings.sizeX - x - 1 : x,
+        k & 2 ? settings.sizeY - y - 1 : y,
+        k & 4 ? settings.sizeZ - z - 1 : z), value);
+    }
   }
 
-  bool Evaluator::isTileSafe(int tile, int x, int y, int z) const {
-    if (!state->in_bounds(x, y, z))
-      return false;
-    return (*state)(x, y, z) == tile;
+  void Evaluator::sweepModeratorLine(int i, int offset) {
+    // Finds every cell-moderator-cell segment of one line in a single pass.
+    int lastCell(-1), moderators{};
+    for (; (*state)[i] != Casing; i += offset) {
+      int tile((*state)[i]);
+      if (tile == Cell) {
+        if (lastCell >= 0 && moderators <= 4) {
+          ++adjacentCells[lastCell];
+          ++adjacentCells[i];
+          if (moderators) {
+            isActive[lastCell + offset] = true;
+            isActive[i - offset] = true;
+            for (int n(lastCell + offset); n != i; n += offset)
+              isModeratorInLine[n] = true;
+          }
+        }
+        lastCell = i;
+        moderators = 0;
+      } else if (tile == Moderator) {
+        ++moderators;
+      } else {
+        lastCell = -1;
+      }
+    }
   }
 
-  int Evaluator::countNeighbors(int tile, int x, int y, int z) const {
-    return
-      + isTileSafe(tile, x - 1, y, z)
-      + isTileSafe(tile, x + 1, y, z)
-      + isTileSafe(tile, x, y - 1, z)
-      + isTileSafe(tile, x, y + 1, z)
-      + isTileSafe(tile, x, y, z - 1)
-      + isTileSafe(tile, x, y, z + 1);
+  bool Evaluator::isActiveAt(int tile, int i) const {
+    return (*state)[i] == tile && isActive[i];
   }
 
-  int Evaluator::countCasingNeighbors(int x, int y, int z) const {
-    return
-      + !state->in_bounds(x - 1, y, z)
-      + !state->in_bounds(x + 1, y, z)
-      + !state->in_bounds(x, y - 1, z)
-      + !state->in_bounds(x, y + 1, z)
-      + !state->in_bounds(x, y, z - 1)
-      + !state->in_bounds(x, y, z + 1);
+  template <typename Shape, typename Active>
+  bool Evaluator::checkRule(const Shape &shape, int tile, int i, const Active &active) const {
+    // Runs the compiled placement rule: every clause needs one of its requirements met.
+    bool clause(false);
+    for (auto term(placement.begin(tile)), end(placement.end(tile)); term != end; ++term) {
+      if (!clause) {
+        int target(term->target);
+        bool present(target == Cell || target == Casing);
+        std::array<bool, 6> match;
+        int count{};
+        for (int k{}; k < 6; ++k) {
+          int n(i + shape.offset(k));
+          match[k] = present ? (*state)[n] == target : active(target, n);
+          count += match[k];
+        }
+        switch (term->requirement) {
+          case PlacementRules::Requirement::AtLeast:
+            clause = count >= term->count;
+            break;
+          case PlacementRules::Requirement::Axial:
+            clause = (match[0] && match[1]) || (match[2] && match[3]) || (match[4] && match[5]);
+            break;
+          case PlacementRules::Requirement::Vertex:
+            clause = count == term->count && (match[0] || match[1]) && (match[2] || match[3]) && (match[4] || match[5]);
+            break;
+        }
+      }
+      if (term->lastInClause) {
+        if (!clause)
+          return false;
+        clause = false;
+      }
+    }
+    return true;
   }
 
   void Evaluator::reset(Evaluation &result) {
-    result.invalidTiles.clear();
+    result.invalidTiles.resize(state->size());
+    result.activeCoolers.fill(0);
     result.cellsHeatMult = 0;
     result.cellsEnergyMult = 0;
     result.fuelCellMultiplier = 0;
     result.moderatorCellMultiplier = 0;
-    result.cooling = 0.0;
     result.breed = 0; // Number of Cells
     isActive.fill(false);
     isModeratorInLine.fill(false);
+    adjacentCells.fill(0);
   }
 
-  void Evaluator::initializeRulesAndCellMetrics(Evaluation &result) {
-    for (int x{}; x < settings.sizeX; ++x) {
-      for (int y{}; y < settings.sizeY; ++y) {
-        for (int z{}; z < settings.sizeZ; ++z) {
-          int tile((*this->state)(x, y, z));
+  template <typename Shape>
+  void Evaluator::initializeRulesAndCellMetrics(const Shape &shape, Evaluation &result) {
+    // Segments reaching into the domain start at most five tiles before it.
+    auto &[x0, y0, z0] = passBegin;
+    int xSweep(std::max(0, x0 - 5)), ySweep(std::max(0, y0 - 5)), zSweep(std::max(0, z0 - 5));
+    for (int x(x0); x < shape.sizeX; ++x) {
+      for (int y(y0); y < shape.sizeY; ++y)
+        sweepModeratorLine(shape.index(x, y, zSweep), shape.offset(5));
+      for (int z(z0); z < shape.sizeZ; ++z)
+        sweepModeratorLine(shape.index(x, ySweep, z), shape.offset(3));
+    }
+    for (int y(y0); y < shape.sizeY; ++y)
+      for (int z(z0); z < shape.sizeZ; ++z)
+        sweepModeratorLine(shape.index(xSweep, y, z), shape.offset(1));
+
+    for (int x(x0); x < shape.sizeX; ++x) {
+      for (int y(y0); y < shape.sizeY; ++y) {
+        for (int i(shape.index(x, y, z0)), end(shape.index(x, y, shape.sizeZ)); i < end; ++i) {
+          int tile((*state)[i]);
           if (tile == Cell) {
-            int adjFuelCells(countAdjFuelCells(x, y, z));
-            rules(x, y, z) = -1;
-            ++result.breed;
-            result.cellsHeatMult += (adjFuelCells + 1) * (adjFuelCells + 2) / 2;
-            result.cellsEnergyMult += adjFuelCells + 1;
-            result.moderatorCellMultiplier += countNeighbors(Moderator, x, y, z) * (adjFuelCells + 1);
+            int adjFuelCells(adjacentCells[i]), weight(folding ? symWeight[i] : 1);
+            rules[i] = Air;
+            result.breed += weight;
+            result.cellsHeatMult += weight * (adjFuelCells + 1) * (adjFuelCells + 2) / 2;
+            result.cellsEnergyMult += weight * (adjFuelCells + 1);
+            result.moderatorCellMultiplier += weight * countNeighbors(shape, Moderator, i) * (adjFuelCells + 1);
           } else {
-            if (tile < Cell) {
-              rules(x, y, z) = tile;
-            } else {
-              rules(x, y, z) = -1;
-            }
+            rules[i] = tile < Cell ? tile : Air;
           }
         }
       }
     }
   }
 
-  void Evaluator::applyPrimaryActivationRules(Evaluation &result) {
-    for (int x{}; x < settings.sizeX; ++x) {
-      for (int y{}; y < settings.sizeY; ++y) {
-        for (int z{}; z < settings.sizeZ; ++z) {
-          if ((*this->state)(x, y, z) == Moderator) {
-            if (!isModeratorInLine(x, y, z)) {
-              result.invalidTiles.emplace_back(x, y, z);
-            }
-          } else switch (rules(x, y, z)) {
-            case Redstone:
-              isActive(x, y, z) = countNeighbors(Cell, x, y, z);
-              break;
-            case Lapis:
-              isActive(x, y, z) = countNeighbors(Cell, x, y, z) && countCasingNeighbors(x, y, z);
-              break;
-            case Enderium:
-              isActive(x, y, z) = countCasingNeighbors(x, y, z) == 3
-                && (!x || x == settings.sizeX - 1)
-                && (!y || y == settings.sizeY - 1)
-                && (!z || z == settings.sizeZ - 1);
-              break;
-            case Cryotheum:
-              isActive(x, y, z) = countNeighbors(Cell, x, y, z) >= 2 && countActiveNeighbors(Moderator, x, y, z);
-              break;
-            case Manganese:
-              isActive(x, y, z) = countNeighbors(Cell, x, y, z) >= 2;
-              break;
-            default:
-              break;
+  template <typename Shape>
+  void Evaluator::applyActivationRules(const Shape &shape, int pass) {
+    auto active([this](int tile, int i) { return isActiveAt(tile, i); });
+    auto &[x0, y0, z0] = passBegin;
+    for (int x(x0); x < shape.sizeX; ++x)
+      for (int y(y0); y < shape.sizeY; ++y)
+        for (int i(shape.index(x, y, z0)), end(shape.index(x, y, shape.sizeZ)); i < end; ++i)
+          if (tilePass[rules[i]] == pass)
+            isActive[i] = checkRule(shape, rules[i], i, active);
+  }
+
+  template <typename Shape>
+  void Evaluator::accumulateCoolingAndInvalidTiles(const Shape &shape, Evaluation &result) const {
+    auto &[x0, y0, z0] = passBegin;
+    for (int x(x0); x < shape.sizeX; ++x) {
+      for (int y(y0); y < shape.sizeY; ++y) {
+        for (int i(shape.index(x, y, z0)), end(shape.index(x, y, shape.sizeZ)); i < end; ++i) {
+          int tile((*state)[i]);
+          if (tile < Cell) {
+            if (isActive[i])
+              result.activeCoolers[tile] += folding ? symWeight[i] : 1;
+            else
+              setInvalid(result.invalidTiles, i, true);
+          } else if (tile == Moderator && !isModeratorInLine[i]) {
+            setInvalid(result.invalidTiles, i, true);
           }
         }
       }
     }
   }
 
-  void Evaluator::applySecondaryActivationRules() {
-    for (int x{}; x < settings.sizeX; ++x) {
-      for (int y{}; y < settings.sizeY; ++y) {
-        for (int z{}; z < settings.sizeZ; ++z) {
-          switch (rules(x, y, z)) {
-            case Water:
-              isActive(x, y, z) = countNeighbors(Cell, x, y, z) || countActiveNeighbors(Moderator, x, y, z);
-              break;
-            case Quartz:
-              isActive(x, y, z) = countActiveNeighbors(Moderator, x, y, z);
-              break;
-            case Glowstone:
-              isActive(x, y, z) = countActiveNeighbors(Moderator, x, y, z) >= 2;
-              break;
-            case Helium:
-              isActive(x, y, z) = countActiveNeighbors(Redstone, x, y, z) && countCasingNeighbors(x, y, z);
-              break;
-            case Emerald:
-              isActive(x, y, z) = countActiveNeighbors(Moderator, x, y, z) && countNeighbors(Cell, x, y, z);
-              break;
-            case Tin:
-              isActive(x, y, z) =
-                isActiveSafe(Lapis, x - 1, y, z) &&
-                isActiveSafe(Lapis, x + 1, y, z) ||
-                isActiveSafe(Lapis, x, y - 1, z) &&
-                isActiveSafe(Lapis, x, y + 1, z) ||
-                isActiveSafe(Lapis, x, y, z - 1) &&
-                isActiveSafe(Lapis, x, y, z + 1);
-              break;
-            case Magnesium:
-              isActive(x, y, z) = countActiveNeighbors(Moderator, x, y, z) && countCasingNeighbors(x, y, z);
-              break;
-            default:
-              break;
-          }
-        }
+  void Evaluator::evaluate(const State &currentState, Evaluation &result) {
+    this->state = &currentState;
+    // The bitboard backend only knows the stock rules, works on whole planes and ignores
+    // the symmetric domain.
+    bool bitboard(backend == Backend::Bitboard && stockRules);
+    folding = symmetric && !bitboard;
+    passBegin = folding ? domainBegin : std::array<int, 3>{};
+    reset(result);
+    if (bitboard) {
+      initializeRulesAndCellMetrics(shape, result);
+      applyBitboardRules(result);
+      return;
+    }
+    // One case per entry of SpecializedSizes.
+    switch (specializedSize) {
+      case 3: evaluateScalar(FixedGridShape<3, 3, 3>(), result); break;
+      case 5: evaluateScalar(FixedGridShape<5, 5, 5>(), result); break;
+      case 7: evaluateScalar(FixedGridShape<7, 7, 7>(), result); break;
+      case 9: evaluateScalar(FixedGridShape<9, 9, 9>(), result); break;
+      default: evaluateScalar(shape, result); break;
+    }
+  }
+
+  template <typename Shape>
+  void Evaluator::evaluateScalar(const Shape &shape, Evaluation &result) {
+    initializeRulesAndCellMetrics(shape, result);
+    for (int pass{}; pass < placement.getNPasses(); ++pass) {
+      if (folding)
+        mirrorActivity();
+      applyActivationRules(shape, pass);
+    }
+    accumulateCoolingAndInvalidTiles(shape, result);
+  }
+
+  void Evaluator::run(const State &currentState, Evaluation &result) {
+    evaluate(currentState, result);
+    result.compute(settings);
+  }
+
+  void Evaluator::nextGeneration() {
+    if (!++generation) {
+      before.known.fill(0);
+      after.known.fill(0);
+      touched.fill(0);
+      generation = 1;
+    }
+  }
+
+  void Evaluator::touch(int i) {
+    if (touched[i] == generation)
+      return;
+    touched[i] = generation;
+    touchedTiles.emplace_back(i);
+  }
+
+  bool Evaluator::isActiveIn(Snapshot &snapshot, int i) {
+    if (snapshot.known[i] == generation)
+      return snapshot.active[i];
+    this->state = snapshot.state;
+    int tile((*state)[i]);
+    bool result(false);
+    if (tile == Moderator) {
+      result = isModeratorActive(i);
+    } else if (tile < Cell) {
+      result = checkRule(shape, tile, i, [&](int type, int n) {
+        return (*snapshot.state)[n] == type && isActiveIn(snapshot, n);
+      });
+    }
+    snapshot.known[i] = generation;
+    snapshot.active[i] = result;
+    return result;
+  }
+
+  bool Evaluator::isModeratorActive(int i) const {
+    // Active moderators sit next to a cell that reaches another cell through them.
+    for (int offset : shape.offsets) {
+      if ((*state)[i - offset] != Cell)
+        continue;
+      int n(i), length{};
+      while (length < 4 && (*state)[n] == Moderator) {
+        n += offset;
+        ++length;
       }
+      if ((*state)[n] == Cell)
+        return true;
     }
+    return false;
   }
 
-  void Evaluator::applyTertiaryActivationRules() {
-    for (int x{}; x < settings.sizeX; ++x) {
-      for (int y{}; y < settings.sizeY; ++y) {
-        for (int z{}; z < settings.sizeZ; ++z) {
-          switch (rules(x, y, z)) {
-            case Copper:
-              isActive(x, y, z) = countActiveNeighbors(Glowstone, x, y, z);
-              break;
-            case Aluminium:
-              isActive(x, y, z) = countActiveNeighbors(Quartz, x, y, z) && countActiveNeighbors(Lapis, x, y, z);
-              break;
-            case Boron:
-              isActive(x, y, z) = countActiveNeighbors(Quartz, x, y, z) && (countCasingNeighbors(x, y, z) || countActiveNeighbors(Moderator, x, y, z));
-              break;
-            default:
-              break;
-          }
+  bool Evaluator::isModeratorValid(int i) const {
+    // Valid moderators lie on a run of at most four moderators with cells at both ends.
+    for (int axis{}; axis < 3; ++axis) {
+      int offset(shape.offsets[axis * 2 + 1]), begin(i), end(i), length(1);
+      do {
+        begin -= offset;
+        ++length;
+      } while (length <= 5 && (*state)[begin] == Moderator);
+      do {
+        end += offset;
+        ++length;
+      } while (length <= 6 && (*state)[end] == Moderator);
+      if (length <= 6 && (*state)[begin] == Cell && (*state)[end] == Cell)
+        return true;
+    }
+    return false;
+  }
+
+  int Evaluator::countCellsInLine(int i) const {
+    int result{};
+    for (int offset : shape.offsets) {
+      int n(i);
+      for (int length{}; length <= 4; ++length) {
+        n += offset;
+        int tile((*state)[n]);
+        if (tile == Cell) {
+          ++result;
+          break;
         }
+        if (tile != Moderator)
+          break;
       }
     }
+    return result;
   }
 
-  void Evaluator::accumulateCoolingAndInvalidTiles(Evaluation &result) const {
-    for (int x{}; x < settings.sizeX; ++x) {
-      for (int y{}; y < settings.sizeY; ++y) {
-        for (int z{}; z < settings.sizeZ; ++z) {
-          int tile((*this->state)(x, y, z));
-          if (tile < Cell) {
-            if (isActive(x, y, z))
-              result.cooling += settings.coolingRates[tile];
-            else
-              result.invalidTiles.emplace_back(x, y, z);
-          }
-        }
+  void Evaluator::accumulateTile(Snapshot &snapshot, int i, int weight, Evaluation &result) {
+    this->state = snapshot.state;
+    int tile((*state)[i]);
+    if (tile == Cell) {
+      int adjFuelCells(countCellsInLine(i));
+      result.breed += weight;
+      result.cellsHeatMult += weight * (adjFuelCells + 1) * (adjFuelCells + 2) / 2;
+      result.cellsEnergyMult += weight * (adjFuelCells + 1);
+      result.moderatorCellMultiplier += weight * countNeighbors(shape, Moderator, i) * (adjFuelCells + 1);
+    } else if (tile < Cell && isActiveIn(snapshot, i)) {
+      result.activeCoolers[tile] += weight;
+    }
+  }
+
+  void Evaluator::applyDelta(const State &prevState, const Evaluation &prevEvaluation,
+                             const State &currentState, const Coords &changedCoords, Evaluation &result) {
+    updateDelta(prevState, prevEvaluation, currentState, changedCoords, result);
+    result.compute(settings);
+    if (differentialCheck)
+      verifyDelta(currentState, result);
+  }
+
+  void Evaluator::removeInvalidTiles(State &state, Evaluation &result, std::vector<std::pair<int, int>> &removed) {
+    removed.clear();
+    pruneBefore = state;
+    for (;;) {
+      pruneCoords.clear();
+      for (int i : result.invalidTiles)
+        if (state[i] != Air)
+          pruneCoords.emplace_back(state.coords(i));
+      if (pruneCoords.empty())
+        break;
+      for (auto &[x, y, z] : pruneCoords) {
+        int i(state.index(x, y, z));
+        removed.emplace_back(i, state[i]);
+        state[i] = Air;
       }
+      if (static_cast<int>(pruneCoords.size()) * pruneFullRunShare > settings.sizeX * settings.sizeY * settings.sizeZ) {
+        run(state, result);
+      } else {
+        updateDelta(pruneBefore, result, state, pruneCoords, result);
+        result.compute(settings);
+      }
+      for (auto &[x, y, z] : pruneCoords)
+        pruneBefore(x, y, z) = Air;
     }
+    if (differentialCheck)
+      verifyDelta(state, result);
   }
 
-  void Evaluator::run(const xt::xtensor<int, 3> &currentState, Evaluation &result) {
+  void Evaluator::updateDelta(const State &prevState, const Evaluation &prevEvaluation,
+                              const State &currentState, const Coords &changedCoords, Evaluation &result) {
+    nextGeneration();
+    before.state = &prevState;
+    after.state = &currentState;
+    if (&result != &prevEvaluation)
+      result = prevEvaluation;
+
+    // Cell multipliers and moderator lines only reach five tiles along each axis.
+    touchedTiles.clear();
+    // In symmetric mode every tile is represented by its image in the fundamental domain.
+    for (auto &[x, y, z] : changedCoords) {
+      int i(currentState.index(x, y, z));
+      touch(representative(i));
+      for (int offset : shape.offsets)
+        for (int n(i + offset), length{}; length < 5 && currentState[n] != Casing; n += offset, ++length)
+          touch(representative(n));
+    }
+
+    // Heat sinks only change when a neighbour changed its tile or activity.
+    for (size_t k{}; k < touchedTiles.size(); ++k) {
+      int i(touchedTiles[k]);
+      if (prevState[i] == currentState[i] && isActiveIn(before, i) == isActiveIn(after, i))
+        continue;
+      for (int offset : shape.offsets)
+        if (prevState[i + offset] < Cell || currentState[i + offset] < Cell)
+          touch(representative(i + offset));
+    }
+
+    for (int i : touchedTiles) {
+      accumulateTile(before, i, -symWeight[i], result);
+      accumulateTile(after, i, +symWeight[i], result);
+    }
+
     this->state = &currentState;
-    reset(result);
-    initializeRulesAndCellMetrics(result);
-    applyPrimaryActivationRules(result);
-    applySecondaryActivationRules();
-    applyTertiaryActivationRules();
-    accumulateCoolingAndInvalidTiles(result);
+    for (int i : touchedTiles) {
+      int tile(currentState[i]);
+      setInvalid(result.invalidTiles, i, tile == Moderator ? !isModeratorValid(i) : tile < Cell && !isActiveIn(after, i));
+    }
+  }
 
-    result.compute(settings);
+  void Evaluator::verifyDelta(const State &currentState, const Evaluation &result) {
+    run(currentState, checkResult);
+    if (result.invalidTiles != checkResult.invalidTiles
+      || result.activeCoolers != checkResult.activeCoolers
+      || result.breed != checkResult.breed
+      || result.fuelCellMultiplier != checkResult.fuelCellMultiplier
+      || result.moderatorCellMultiplier != checkResult.moderatorCellMultiplier
+      || result.cellsHeatMult != checkResult.cellsHeatMult
+      || result.cellsEnergyMult != checkResult.cellsEnergyMult)
+      throw std::logic_error("Incremental evaluation diverged from full evaluation");
   }
 }
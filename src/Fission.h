@@ -1,7 +1,11 @@
 #ifndef _FISSION_H_
 #define _FISSION_H_
 #include <array>
-#include <xtensor/xtensor.hpp>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include "Grid.h"
 
 namespace Fission {
   using Coords = std::vector<std::tuple<int, int, int>>;
@@ -11,7 +15,9 @@ namespace Fission {
     Water, Copper, Cryotheum, Enderium, Redstone, Helium, Boron, Lapis,
     Emerald, Quartz, Tin, Aluminium, Magnesium, Manganese, Glowstone,
     // Other
-    Cell, Moderator, Air
+    Cell, Moderator, Air,
+    // Border of a padded state, never placed by the optimizer
+    Casing
   };
 
   enum class Goal : int {
@@ -20,9 +26,63 @@ namespace Fission {
     Efficiency
   };
 
+  enum class Backend : int {
+    Scalar,
+    Bitboard
+  };
+
   constexpr int TileCount = static_cast<int>(Tile::Air);
   constexpr int CoolerCount = static_cast<int>(Tile::Cell);
 
+  using State = PaddedGrid<std::uint8_t>;
+
+  // Heat sink placement rules in the placement_rule notation of config/heat_sinks, compiled into
+  // a flat table. A rule is a list of clauses that must all hold; a clause is a list of
+  // '|'-separated requirements of which one must hold. Requirements count the neighbours that
+  // are cells, casing, active moderators or active heat sinks of a type:
+  //   "lapis_heat_sink"                         at least one
+  //   "fission_reactor_solid_fuel_cell>2"       at least two
+  //   "lapis_heat_sink-2"                       two on opposite sides along one axis
+  //   "#nuclearcraft:fission_reactor_casing^3"  exactly three, meeting at a vertex
+  // Sinks are grouped into passes so that every sink type a rule refers to is settled first.
+  class PlacementRules {
+  public:
+    enum class Requirement : std::uint8_t {
+      AtLeast,
+      Axial,
+      Vertex
+    };
+
+    struct Term {
+      Requirement requirement;
+      std::uint8_t target, count;
+      bool lastInClause;
+      bool operator==(const Term &other) const;
+    };
+  private:
+    std::array<std::vector<Term>, CoolerCount> rules;
+    std::vector<Term> program;
+    std::array<int, CoolerCount + 1> programBegin;
+    std::array<int, CoolerCount> passes;
+    int nPasses;
+
+    static Term parseTerm(const std::string &text);
+  public:
+    // The rules of the stock heat sinks.
+    PlacementRules();
+    // Maps a heat sink "type" such as "liquid_helium" to its tile; throws on unknown types.
+    static int parseSinkType(const std::string &type);
+    // Replaces the rule of a sink; takes effect at the next compile.
+    void setRule(int sink, const std::vector<std::string> &placementRule);
+    // Rebuilds the table and passes; throws when rules depend on each other in a cycle.
+    void compile();
+    const Term *begin(int sink) const { return program.data() + programBegin[sink]; }
+    const Term *end(int sink) const { return program.data() + programBegin[sink + 1]; }
+    int getPass(int sink) const { return passes[sink]; }
+    int getNPasses() const { return nPasses; }
+    bool operator==(const PlacementRules &other) const { return rules == other.rules; }
+  };
+
   struct Settings {
     int sizeX, sizeY, sizeZ;
     double fuelBasePower, fuelBaseHeat;
@@ -32,15 +92,18 @@ namespace Fission {
     Goal goal;
     bool symX, symY, symZ;
     double genMult, heatMult, modFEMult, modHeatMult, FEGenMult;
+    // Null selects the stock rules.
+    std::shared_ptr<const PlacementRules> placementRules;
   };
 
   struct Evaluation {
     // Raw
-    Coords invalidTiles;
-    double cooling;
+    // Padded linear indices of moderators and heat sinks that are not valid.
+    TileMask invalidTiles;
+    std::array<int, CoolerCount> activeCoolers;
     int breed, fuelCellMultiplier, moderatorCellMultiplier, cellsHeatMult, cellsEnergyMult;
     // Computed
-    double heat, netHeat, dutyCycle, power, avgPower, avgBreed, efficiency, heatLimit;
+    double cooling, heat, netHeat, dutyCycle, power, avgPower, avgBreed, efficiency, heatLimit;
 
     void compute(const Settings &settings);
 
@@ -48,30 +111,136 @@ namespace Fission {
   };
 
   class Evaluator {
+    // Lazily evaluated activity of one side of an incremental update.
+    struct Snapshot {
+      const State *state;
+      PaddedGrid<unsigned> known;
+      PaddedGrid<std::uint8_t> active;
+    };
+
     const Settings &settings;
-    xt::xtensor<int, 3> rules;
-    xt::xtensor<bool, 3> isActive, isModeratorInLine, visited;
-    const xt::xtensor<int, 3> *state;
-    
+    PlacementRules placement;
+    // Pass of each tile's rule, -1 for tiles without one; the bitboard only knows the stock rules.
+    std::array<int, static_cast<int>(Tile::Casing) + 1> tilePass;
+    bool stockRules;
+    GridShape shape;
+    // Edge length of the compile-time specialized passes in use, or 0 for the generic ones.
+    int specializedSize;
+    PaddedGrid<std::uint8_t> rules, isActive, isModeratorInLine, adjacentCells;
+    const State *state;
+    Snapshot before, after;
+    PaddedGrid<unsigned> touched;
+    unsigned generation;
+    std::vector<int> touchedTiles;
+    // removeInvalidTiles: the state before the latest round of removals, and the tiles it removes.
+    State pruneBefore;
+    Coords pruneCoords;
+    bool differentialCheck;
+    Evaluation checkResult;
+    Backend backend;
+    // Symmetric mode: states are mirror-symmetric along the settings' sym axes, so only the
+    // fundamental domain (coordinates from size / 2 on each such axis) is evaluated.
+    bool symmetric, folding;
+    std::array<int, 3> domainBegin, passBegin;
+    PaddedGrid<std::uint8_t> symWeight;
+    PaddedGrid<int> fold;
+    // Bitboard backend: one bit per padded tile, in the same linear order as State.
+    int planeWords, planeMargin, planeStride;
+    std::vector<std::uint64_t> planes;
+
+    void evaluate(const State &currentState, Evaluation &result);
+    void updateDelta(const State &prevState, const Evaluation &prevEvaluation,
+                     const State &currentState, const Coords &changedCoords, Evaluation &result);
     void reset(Evaluation &result);
-    void initializeRulesAndCellMetrics(Evaluation &result);
-    void applyPrimaryActivationRules(Evaluation &result);
-    void applySecondaryActivationRules();
-    void applyTertiaryActivationRules();
-    void accumulateCoolingAndInvalidTiles(Evaluation &result) const;
-
-    int getTileSafe(int x, int y, int z) const;
-    bool hasCellInLine(int x, int y, int z, int dx, int dy, int dz);
-    int countAdjFuelCells(int x, int y, int z);
-    int isActiveSafe(int tile, int x, int y, int z) const;
-    int countActiveNeighbors(int tile, int x, int y, int z) const;
-    bool isTileSafe(int tile, int x, int y, int z) const;
-    int countNeighbors(int tile, int x, int y, int z) const;
-    int countCasingNeighbors(int x, int y, int z) const;
+    // The full scalar passes are templated on the grid shape; see GridShape and FixedGridShape.
+    template <typename Shape>
+    void evaluateScalar(const Shape &shape, Evaluation &result);
+    template <typename Shape>
+    void initializeRulesAndCellMetrics(const Shape &shape, Evaluation &result);
+    template <typename Shape>
+    void applyActivationRules(const Shape &shape, int pass);
+    template <typename Shape>
+    void accumulateCoolingAndInvalidTiles(const Shape &shape, Evaluation &result) const;
+    void initializeSymmetry();
+    void mirrorActivity();
+    void setInvalid(TileMask &invalidTiles, int i, bool value) const;
+    int representative(int i) const { return symmetric ? fold[i] : i; }
+
+    void sweepModeratorLine(int i, int offset);
+    bool isActiveAt(int tile, int i) const;
+    template <typename Shape>
+    int countNeighbors(const Shape &shape, int tile, int i) const;
+    template <typename Shape>
+    int countCasingNeighbors(const Shape &shape, int i) const;
+    template <typename Shape>
+    bool isCorner(const Shape &shape, int i) const;
+    template <typename Shape, typename Active>
+    bool checkRule(const Shape &shape, int tile, int i, const Active &active) const;
+
+    void nextGeneration();
+    void touch(int i);
+    bool isActiveIn(Snapshot &snapshot, int i);
+    bool isModeratorActive(int i) const;
+    bool isModeratorValid(int i) const;
+    int countCellsInLine(int i) const;
+    void accumulateTile(Snapshot &snapshot, int i, int weight, Evaluation &result);
+    void verifyDelta(const State &currentState, const Evaluation &result);
+
+    std::uint64_t *getPlane(int index) { return planes.data() + index * planeStride + planeMargin; }
+    void initializeBitboard();
+    void loadBitboard();
+    void shiftPlane(int source, int offset, int target);
+    void countPlaneNeighbors(int source, int any, int two);
+    void applyBitboardRules(Evaluation &result);
   public:
     explicit Evaluator(const Settings &settings);
-    void run(const xt::xtensor<int, 3> &currentState, Evaluation &result);
+    void run(const State &currentState, Evaluation &result);
+    // Re-evaluates only the neighbourhood of changedCoords, given a full evaluation of prevState.
+    // prevState and currentState must differ only at changedCoords.
+    void applyDelta(const State &prevState, const Evaluation &prevEvaluation,
+                    const State &currentState, const Coords &changedCoords, Evaluation &result);
+    // Clears the tiles result marks invalid to air, and then the tiles that become invalid in turn, until
+    // none are left. Each round re-evaluates only around its removals, as applyDelta does, unless it clears
+    // so many that a full run is cheaper. removed gets the padded indices and former tiles of all cleared tiles.
+    void removeInvalidTiles(State &state, Evaluation &result, std::vector<std::pair<int, int>> &removed);
+    // Cross-check every applyDelta against a full run and throw on mismatch.
+    void setDifferentialCheck(bool enabled) { differentialCheck = enabled; }
+    void setBackend(Backend value) { backend = value; }
+    // Only valid for states that are symmetric along every sym axis of the settings.
+    void setSymmetric(bool enabled);
+    bool isSymmetric() const { return symmetric; }
+    // Full runs of cubic cores with an edge in SpecializedSizes use passes compiled for that size.
+    static constexpr std::array<int, 4> SpecializedSizes{3, 5, 7, 9};
+    void setSpecialization(bool enabled);
+    bool isSpecialized() const { return specializedSize; }
+    Backend getBackend() const { return backend; }
   };
+
+  template <typename Shape>
+  int Evaluator::countNeighbors(const Shape &shape, int tile, int i) const {
+    return
+      + ((*state)[i + shape.offset(0)] == tile)
+      + ((*state)[i + shape.offset(1)] == tile)
+      + ((*state)[i + shape.offset(2)] == tile)
+      + ((*state)[i + shape.offset(3)] == tile)
+      + ((*state)[i + shape.offset(4)] == tile)
+      + ((*state)[i + shape.offset(5)] == tile);
+  }
+
+  template <typename Shape>
+  int Evaluator::countCasingNeighbors(const Shape &shape, int i) const {
+    return countNeighbors(shape, static_cast<int>(Tile::Casing), i);
+  }
+
+  template <typename Shape>
+  bool Evaluator::isCorner(const Shape &shape, int i) const {
+    // Exactly three casing neighbours, one along each axis.
+    constexpr int Casing = static_cast<int>(Tile::Casing);
+    return countCasingNeighbors(shape, i) == 3
+      && ((*state)[i + shape.offset(0)] == Casing || (*state)[i + shape.offset(1)] == Casing)
+      && ((*state)[i + shape.offset(2)] == Casing || (*state)[i + shape.offset(3)] == Casing)
+      && ((*state)[i + shape.offset(4)] == Casing || (*state)[i + shape.offset(5)] == Casing);
+  }
 }
 
 #endif
@@ -0,0 +1,176 @@
+#include <algorithm>
+#include "Fission.h"
+
+namespace Fission {
+  namespace {
+    using Word = TileMask::Word;
+    constexpr int WordBits = TileMask::WordBits;
+
+    constexpr int Water = static_cast<int>(Tile::Water);
+    constexpr int Copper = static_cast<int>(Tile::Copper);
+    constexpr int Cryotheum = static_cast<int>(Tile::Cryotheum);
+    constexpr int Enderium = static_cast<int>(Tile::Enderium);
+    constexpr int Redstone = static_cast<int>(Tile::Redstone);
+    constexpr int Helium = static_cast<int>(Tile::Helium);
+    constexpr int Boron = static_cast<int>(Tile::Boron);
+    constexpr int Lapis = static_cast<int>(Tile::Lapis);
+    constexpr int Emerald = static_cast<int>(Tile::Emerald);
+    constexpr int Quartz = static_cast<int>(Tile::Quartz);
+    constexpr int Tin = static_cast<int>(Tile::Tin);
+    constexpr int Aluminium = static_cast<int>(Tile::Aluminium);
+    constexpr int Magnesium = static_cast<int>(Tile::Magnesium);
+    constexpr int Manganese = static_cast<int>(Tile::Manganese);
+    constexpr int Glowstone = static_cast<int>(Tile::Glowstone);
+    constexpr int Cell = static_cast<int>(Tile::Cell);
+    constexpr int Moderator = static_cast<int>(Tile::Moderator);
+    constexpr int Air = static_cast<int>(Tile::Air);
+    constexpr int Casing = static_cast<int>(Tile::Casing);
+
+    // Plane indices: one per tile type, then activity of heat sinks and moderators, then constants and scratch.
+    constexpr int ActivePlanes = Casing + 1;
+    enum : int {
+      InLinePlane = ActivePlanes + Moderator + 1,
+      CasingAdjacentPlane, CornerPlane,
+      CellAny, CellTwo, ModeratorAny, ModeratorTwo,
+      RedstoneAny, LapisAny, LapisPairs, GlowstoneAny, QuartzAny,
+      ShiftedPlane, PairedPlane,
+      PlaneCount
+    };
+  }
+
+  void Evaluator::initializeBitboard() {
+    const State casing(settings.sizeX, settings.sizeY, settings.sizeZ, Air, Casing);
+    planeWords = (casing.size() + WordBits - 1) / WordBits;
+    // Shifted reads may reach one x-slab plus one word beyond either end of a plane.
+    planeMargin = shape.strideX / WordBits + 2;
+    planeStride = planeWords + planeMargin * 2;
+    planes.assign(static_cast<size_t>(planeStride) * PlaneCount, 0);
+
+    state = &casing;
+    Word *casingAdjacent(getPlane(CasingAdjacentPlane)), *corner(getPlane(CornerPlane));
+    for (int x{}; x < settings.sizeX; ++x) {
+      for (int y{}; y < settings.sizeY; ++y) {
+        for (int i(casing.index(x, y, 0)), end(i + settings.sizeZ); i < end; ++i) {
+          Word bit(Word(1) << i % WordBits);
+          if (countCasingNeighbors(shape, i))
+            casingAdjacent[i / WordBits] |= bit;
+          if (isCorner(shape, i))
+            corner[i / WordBits] |= bit;
+        }
+      }
+    }
+    state = nullptr;
+  }
+
+  void Evaluator::loadBitboard() {
+    std::fill_n(getPlane(0), planeStride * (ActivePlanes - 1) + planeWords, 0);
+    std::fill_n(getPlane(ActivePlanes + Moderator), planeStride + planeWords, 0);
+    Word *moderatorActive(getPlane(ActivePlanes + Moderator)), *inLine(getPlane(InLinePlane));
+    for (int i{}, n(state->size()); i < n; ++i) {
+      int w(i / WordBits);
+      Word bit(Word(1) << i % WordBits);
+      getPlane((*state)[i])[w] |= bit;
+      // Only moderators are active after the line pass.
+      moderatorActive[w] |= bit & -Word(isActive[i]);
+      inLine[w] |= bit & -Word(isModeratorInLine[i]);
+    }
+  }
+
+  void Evaluator::shiftPlane(int source, int offset, int target) {
+    // Bit i of the target becomes bit i + offset of the source.
+    const Word *src(getPlane(source));
+    Word *dst(getPlane(target));
+    int wordShift(offset >= 0 ? offset / WordBits : -((-offset + WordBits - 1) / WordBits));
+    int bitShift(offset - wordShift * WordBits);
+    src += wordShift;
+    if (bitShift) {
+      for (int w{}; w < planeWords; ++w)
+        dst[w] = src[w] >> bitShift | src[w + 1] << (WordBits - bitShift);
+    } else {
+      std::copy_n(src, planeWords, dst);
+    }
+  }
+
+  void Evaluator::countPlaneNeighbors(int source, int any, int two) {
+    Word *anyPlane(getPlane(any)), *twoPlane(getPlane(two)), *shifted(getPlane(ShiftedPlane));
+    std::fill_n(anyPlane, planeWords, 0);
+    std::fill_n(twoPlane, planeWords, 0);
+    for (int offset : shape.offsets) {
+      shiftPlane(source, offset, ShiftedPlane);
+      for (int w{}; w < planeWords; ++w) {
+        twoPlane[w] |= anyPlane[w] & shifted[w];
+        anyPlane[w] |= shifted[w];
+      }
+    }
+  }
+
+  void Evaluator::applyBitboardRules(Evaluation &result) {
+    loadBitboard();
+    auto tile([this](int type) { return getPlane(type); });
+    auto active([this](int type) { return getPlane(ActivePlanes + type); });
+    const Word *casingAdjacent(getPlane(CasingAdjacentPlane)), *corner(getPlane(CornerPlane));
+
+    // Primary
+    countPlaneNeighbors(Cell, CellAny, CellTwo);
+    countPlaneNeighbors(ActivePlanes + Moderator, ModeratorAny, ModeratorTwo);
+    const Word *cellAny(getPlane(CellAny)), *cellTwo(getPlane(CellTwo));
+    const Word *moderatorAny(getPlane(ModeratorAny)), *moderatorTwo(getPlane(ModeratorTwo));
+    for (int w{}; w < planeWords; ++w) {
+      active(Redstone)[w] = tile(Redstone)[w] & cellAny[w];
+      active(Lapis)[w] = tile(Lapis)[w] & cellAny[w] & casingAdjacent[w];
+      active(Enderium)[w] = tile(Enderium)[w] & corner[w];
+      active(Cryotheum)[w] = tile(Cryotheum)[w] & cellTwo[w] & moderatorAny[w];
+      active(Manganese)[w] = tile(Manganese)[w] & cellTwo[w];
+    }
+
+    // Secondary
+    countPlaneNeighbors(ActivePlanes + Redstone, RedstoneAny, PairedPlane);
+    Word *lapisAny(getPlane(LapisAny)), *lapisPairs(getPlane(LapisPairs));
+    const Word *shifted(getPlane(ShiftedPlane)), *paired(getPlane(PairedPlane));
+    std::fill_n(lapisAny, planeWords, 0);
+    std::fill_n(lapisPairs, planeWords, 0);
+    for (int axis{}; axis < 3; ++axis) {
+      shiftPlane(ActivePlanes + Lapis, shape.offsets[axis * 2], ShiftedPlane);
+      shiftPlane(ActivePlanes + Lapis, shape.offsets[axis * 2 + 1], PairedPlane);
+      for (int w{}; w < planeWords; ++w) {
+        lapisAny[w] |= shifted[w] | paired[w];
+        lapisPairs[w] |= shifted[w] & paired[w];
+      }
+    }
+    const Word *redstoneAny(getPlane(RedstoneAny));
+    for (int w{}; w < planeWords; ++w) {
+      active(Water)[w] = tile(Water)[w] & (cellAny[w] | moderatorAny[w]);
+      active(Quartz)[w] = tile(Quartz)[w] & moderatorAny[w];
+      active(Glowstone)[w] = tile(Glowstone)[w] & moderatorTwo[w];
+      active(Helium)[w] = tile(Helium)[w] & redstoneAny[w] & casingAdjacent[w];
+      active(Emerald)[w] = tile(Emerald)[w] & moderatorAny[w] & cellAny[w];
+      active(Tin)[w] = tile(Tin)[w] & lapisPairs[w];
+      active(Magnesium)[w] = tile(Magnesium)[w] & moderatorAny[w] & casingAdjacent[w];
+    }
+
+    // Tertiary
+    countPlaneNeighbors(ActivePlanes + Glowstone, GlowstoneAny, PairedPlane);
+    countPlaneNeighbors(ActivePlanes + Quartz, QuartzAny, PairedPlane);
+    const Word *glowstoneAny(getPlane(GlowstoneAny)), *quartzAny(getPlane(QuartzAny));
+    for (int w{}; w < planeWords; ++w) {
+      active(Copper)[w] = tile(Copper)[w] & glowstoneAny[w];
+      active(Aluminium)[w] = tile(Aluminium)[w] & quartzAny[w] & lapisAny[w];
+      active(Boron)[w] = tile(Boron)[w] & quartzAny[w] & (casingAdjacent[w] | moderatorAny[w]);
+    }
+
+    // Cooling and invalid tiles, written straight into the result mask.
+    Word *invalid(result.invalidTiles.data());
+    const Word *inLine(getPlane(InLinePlane));
+    for (int w{}; w < planeWords; ++w)
+      invalid[w] = tile(Moderator)[w] & ~inLine[w];
+    for (int type{}; type < Cell; ++type) {
+      const Word *sinks(tile(type)), *sinksActive(active(type));
+      int count{};
+      for (int w{}; w < planeWords; ++w) {
+        count += TileMask::popCount(sinksActive[w]);
+        invalid[w] |= sinks[w] & ~sinksActive[w];
+      }
+      result.activeCoolers[type] = count;
+    }
+  }
+}
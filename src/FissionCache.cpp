@@ -0,0 +1,94 @@
+#include "FissionCache.h"
+#include <random>
+
+namespace Fission {
+  namespace {
+    // Slot layout: sequence, hash, raw integer fields, then the invalid-tile mask.
+    constexpr int HeaderWords = 2;
+    constexpr int RawWords = CoolerCount + 5;
+  }
+
+  TranspositionTable::TranspositionTable(const Settings &settings, int nEntries)
+    :nTiles((settings.sizeX + 2) * (settings.sizeY + 2) * (settings.sizeZ + 2)),
+    nMaskWords((nTiles + TileMask::WordBits - 1) / TileMask::WordBits),
+    slotWords(HeaderWords + RawWords + nMaskWords), slotMask(), hits(), misses() {
+    // Fixed seed, so hashes are reproducible and the optimizer's own random stream is untouched.
+    std::mt19937_64 rng(0x9e3779b97f4a7c15ull);
+    keys.resize(static_cast<size_t>(nTiles) * TileCount);
+    for (auto &key : keys)
+      key = rng();
+    if (nEntries <= 0)
+      return;
+    std::uint64_t nSlots(1);
+    while (nSlots < static_cast<std::uint64_t>(nEntries))
+      nSlots *= 2;
+    slotMask = nSlots - 1;
+    slots = std::vector<std::atomic<std::uint64_t>>(nSlots * slotWords);
+  }
+
+  std::uint64_t TranspositionTable::hashOf(const State &state) const {
+    std::uint64_t result{};
+    for (int i{}; i < state.size(); ++i)
+      result ^= key(i, state[i]);
+    return result;
+  }
+
+  bool TranspositionTable::lookup(std::uint64_t hash, Evaluation &result) {
+    if (slots.empty())
+      return false;
+    std::atomic<std::uint64_t> *slot(&slots[(hash & slotMask) * slotWords]);
+    std::uint64_t sequence(slot[0].load(std::memory_order_acquire));
+    if (sequence & 1 || slot[1].load(std::memory_order_relaxed) != hash) {
+      misses.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    }
+    const std::atomic<std::uint64_t> *raw(slot + HeaderWords);
+    for (int k{}; k < CoolerCount; ++k)
+      result.activeCoolers[k] = static_cast<int>(raw[k].load(std::memory_order_relaxed));
+    raw += CoolerCount;
+    result.breed = static_cast<int>(raw[0].load(std::memory_order_relaxed));
+    result.fuelCellMultiplier = static_cast<int>(raw[1].load(std::memory_order_relaxed));
+    result.moderatorCellMultiplier = static_cast<int>(raw[2].load(std::memory_order_relaxed));
+    result.cellsHeatMult = static_cast<int>(raw[3].load(std::memory_order_relaxed));
+    result.cellsEnergyMult = static_cast<int>(raw[4].load(std::memory_order_relaxed));
+    raw += 5;
+    result.invalidTiles.resize(nTiles);
+    TileMask::Word *mask(result.invalidTiles.data());
+    for (int w{}; w < nMaskWords; ++w)
+      mask[w] = raw[w].load(std::memory_order_relaxed);
+    // A torn read has already overwritten result; callers re-evaluate on a miss anyway.
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (slot[0].load(std::memory_order_relaxed) != sequence) {
+      misses.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    }
+    hits.fetch_add(1, std::memory_order_relaxed);
+    return true;
+  }
+
+  void TranspositionTable::store(std::uint64_t hash, const Evaluation &value) {
+    if (slots.empty())
+      return;
+    std::atomic<std::uint64_t> *slot(&slots[(hash & slotMask) * slotWords]);
+    // Another writer holds the slot: dropping this entry is cheaper than waiting.
+    std::uint64_t sequence(slot[0].load(std::memory_order_relaxed));
+    if (sequence & 1 || !slot[0].compare_exchange_strong(sequence, sequence + 1, std::memory_order_relaxed))
+      return;
+    std::atomic_thread_fence(std::memory_order_release);
+    slot[1].store(hash, std::memory_order_relaxed);
+    std::atomic<std::uint64_t> *raw(slot + HeaderWords);
+    for (int k{}; k < CoolerCount; ++k)
+      raw[k].store(static_cast<std::uint64_t>(value.activeCoolers[k]), std::memory_order_relaxed);
+    raw += CoolerCount;
+    raw[0].store(static_cast<std::uint64_t>(value.breed), std::memory_order_relaxed);
+    raw[1].store(static_cast<std::uint64_t>(value.fuelCellMultiplier), std::memory_order_relaxed);
+    raw[2].store(static_cast<std::uint64_t>(value.moderatorCellMultiplier), std::memory_order_relaxed);
+    raw[3].store(static_cast<std::uint64_t>(value.cellsHeatMult), std::memory_order_relaxed);
+    raw[4].store(static_cast<std::uint64_t>(value.cellsEnergyMult), std::memory_order_relaxed);
+    raw += 5;
+    const TileMask::Word *mask(value.invalidTiles.data());
+    for (int w{}; w < nMaskWords; ++w)
+      raw[w].store(mask[w], std::memory_order_relaxed);
+    slot[0].store(sequence + 2, std::memory_order_release);
+  }
+}
@@ -0,0 +1,29 @@
+#ifndef _FISSION_CACHE_H_
+#define _FISSION_CACHE_H_
+#include <atomic>
+#include "Fission.h"
+
+namespace Fission {
+  // Bounded, lock-free cache of evaluations keyed on Zobrist hashes of states.
+  // Each slot is a sequence lock: readers that race a writer see a miss instead of a torn entry.
+  class TranspositionTable {
+    int nTiles, nMaskWords, slotWords;
+    std::uint64_t slotMask;
+    std::vector<std::uint64_t> keys;
+    std::vector<std::atomic<std::uint64_t>> slots;
+    std::atomic<std::uint64_t> hits, misses;
+  public:
+    // nEntries is rounded up to a power of two; zero disables the cache.
+    TranspositionTable(const Settings &settings, int nEntries);
+    // Contribution of `tile` at padded linear index i to the hash; Air contributes nothing.
+    std::uint64_t key(int i, int tile) const { return tile < TileCount ? keys[static_cast<size_t>(i) * TileCount + tile] : 0; }
+    std::uint64_t hashOf(const State &state) const;
+    // Fills the raw fields of result; derived metrics are left to the caller.
+    bool lookup(std::uint64_t hash, Evaluation &result);
+    void store(std::uint64_t hash, const Evaluation &value);
+    std::uint64_t getHits() const { return hits.load(std::memory_order_relaxed); }
+    std::uint64_t getMisses() const { return misses.load(std::memory_order_relaxed); }
+  };
+}
+
+#endif
@@ -0,0 +1,50 @@
+#include "FissionLinalg.h"
+#include <algorithm>
+
+namespace Fission {
+  namespace {
+    // Rows of B kept hot while multiply sweeps the rows of A, and rows of C accumulated at once by
+    // multiplyTransposed; a block is at most 64 rows of 128 doubles, well within L2.
+    constexpr int blockRows(64);
+    constexpr int transposeTile(16);
+
+    // y[0, n) += alpha x[0, n)
+    inline void multiplyAdd(int n, double alpha, const double *x, double *y) {
+      for (int j{}; j < n; ++j)
+        y[j] += alpha * x[j];
+    }
+  }
+
+  void multiply(int m, int n, int k, const double *a, const double *b, double *c) {
+    std::fill(c, c + static_cast<long>(m) * n, 0.0);
+    for (int k0{}; k0 < k; k0 += blockRows) {
+      int k1(std::min(k, k0 + blockRows));
+      for (int i{}; i < m; ++i) {
+        const double *aRow(a + static_cast<long>(i) * k);
+        double *cRow(c + static_cast<long>(i) * n);
+        for (int l(k0); l < k1; ++l)
+          multiplyAdd(n, aRow[l], b + static_cast<long>(l) * n, cRow);
+      }
+    }
+  }
+
+  void multiplyTransposed(int m, int n, int k, const double *a, const double *b, double *c) {
+    std::fill(c, c + static_cast<long>(m) * n, 0.0);
+    for (int i0{}; i0 < m; i0 += blockRows) {
+      int i1(std::min(m, i0 + blockRows));
+      for (int l{}; l < k; ++l) {
+        const double *aRow(a + static_cast<long>(l) * m), *bRow(b + static_cast<long>(l) * n);
+        for (int i(i0); i < i1; ++i)
+          multiplyAdd(n, aRow[i], bRow, c + static_cast<long>(i) * n);
+      }
+    }
+  }
+
+  void transpose(int rows, int cols, const double *a, double *b) {
+    for (int i0{}; i0 < rows; i0 += transposeTile)
+      for (int j0{}; j0 < cols; j0 += transposeTile)
+        for (int i(i0); i < std::min(rows, i0 + transposeTile); ++i)
+          for (int j(j0); j < std::min(cols, j0 + transposeTile); ++j)
+            b[static_cast<long>(j) * rows + i] = a[static_cast<long>(i) * cols + j];
+  }
+}
@@ -0,0 +1,17 @@
+#ifndef _FISSION_LINALG_H_
+#define _FISSION_LINALG_H_
+
+namespace Fission {
+  // Dense kernels behind Net, on row-major matrices stored contiguously. Each one overwrites its
+  // output. The loops are blocked so that the reused operand stays in cache, and their innermost
+  // loop is a contiguous multiply-add over an output row, which the compiler vectorizes.
+
+  // C[m x n] = A[m x k] B[k x n]
+  void multiply(int m, int n, int k, const double *a, const double *b, double *c);
+  // C[m x n] = A[k x m]^T B[k x n], the sum over the k rows of the outer products of A's and B's rows.
+  void multiplyTransposed(int m, int n, int k, const double *a, const double *b, double *c);
+  // B[cols x rows] = A[rows x cols]^T
+  void transpose(int rows, int cols, const double *a, double *b);
+}
+
+#endif
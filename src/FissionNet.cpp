@@ -1,151 +1,442 @@
-#include <xtensor/xrandom.hpp>
+#include <algorithm>
+#include <cmath>
+#include "Checkpoint.h"
+#include "FissionLinalg.h"
 #include "FissionNet.h"
 
 namespace Fission {
   namespace {
     constexpr int Air = static_cast<int>(Tile::Air);
+    constexpr std::size_t poolMinRows(4096);
+    // Snapshot slot indices in middle, and the flag of one not yet taken by the search.
+    constexpr int slotMask(3), freshSlot(4);
+    // Training steps of the background trainer between published snapshots.
+    constexpr std::size_t snapshotInterval(32);
+    // Most training steps the background trainer spends on the trajectories it takes at once.
+    constexpr int maxAsyncSteps(4096);
+
+    std::vector<double> randn(std::size_t n, double stdDev, std::mt19937 &rng) {
+      std::normal_distribution<double> dist(0.0, stdDev);
+      std::vector<double> result(n);
+      for (auto &x : result)
+        x = dist(rng);
+      return result;
+    }
+
+    // One Adam step on n parameters with gradients g and moments m and r.
+    void adam(std::size_t n, double mCorrector, double rCorrector, const double *g, double *m, double *r, double *w) {
+      for (std::size_t i{}; i < n; ++i) {
+        m[i] = mRate * m[i] + (1 - mRate) * g[i];
+        r[i] = rRate * r[i] + (1 - rRate) * (g[i] * g[i]);
+        w[i] -= lRate * m[i] / ((1 - mCorrector) * (std::sqrt(r[i] / (1 - rCorrector)) + 1e-8));
+      }
+    }
   }
 
-  Net::Net(Opt &opt) :opt(opt), mCorrector(1), rCorrector(1), trajectoryLength(), writePos() {
+  void Net::Activations::resize(int nRows) {
+    vLayer1.resize(nRows * nLayer1);
+    vPwlLayer1.resize(vLayer1.size());
+    vLayer2.resize(nRows * nLayer2);
+    vPwlLayer2.resize(vLayer2.size());
+    vOutput.resize(nRows);
+  }
+
+  Net::Net(Opt &opt) :opt(opt), mCorrector(1), rCorrector(1), trajectoryLength(), writePos(),
+    inferSnapshot(&current), async(), middle(), back(), front() {
+    nTiles = 0;
     for (int i{}; i < Air; ++i)
-      if (opt.settings.limit[i])
-        tileMap.emplace(i, tileMap.size());
-    tileMap.emplace(Air, tileMap.size());
-    nFeatures = static_cast<int>(tileMap.size() * 2 - 1 + nStatisticalFeatures);
-    batchInput = xt::empty<double>({nMiniBatch, nFeatures});
-    batchTarget = xt::empty<double>({nMiniBatch});
-
-    wLayer1 = xt::random::randn({nLayer1, nFeatures}, 0.0, 1.0 / std::sqrt(nFeatures), opt.rng);
-    mwLayer1 = xt::zeros_like(wLayer1);
-    rwLayer1 = xt::zeros_like(wLayer1);
-    bLayer1 = xt::zeros<double>({nLayer1});
-    mbLayer1 = xt::zeros_like(bLayer1);
-    rbLayer1 = xt::zeros_like(bLayer1);
-
-    wLayer2 = xt::random::randn({nLayer2, nLayer1}, 0.0, 1.0 / std::sqrt(nLayer1), opt.rng);
-    mwLayer2 = xt::zeros_like(wLayer2);
-    rwLayer2 = xt::zeros_like(wLayer2);
-    bLayer2 = xt::zeros<double>({nLayer2});
-    mbLayer2 = xt::zeros_like(bLayer2);
-    rbLayer2 = xt::zeros_like(bLayer2);
-
-    wOutput = xt::random::randn({nLayer2}, 0.0, 1.0 / std::sqrt(nLayer2), opt.rng);
-    mwOutput = xt::zeros_like(wOutput);
-    rwOutput = xt::zeros_like(wOutput);
+      tileMap[i] = opt.settings.limit[i] ? nTiles++ : -1;
+    tileMap[Air] = nTiles++;
+    nFeatures = nTiles * 2 - 1 + nStatisticalFeatures;
+    batchInput.resize(nMiniBatch * nFeatures);
+    batchTarget.resize(nMiniBatch);
+    const int nChildren(static_cast<int>(opt.childMutations.size()));
+    inferInput.resize(std::max(1, nChildren) * nFeatures);
+
+    wLayer1 = randn(nLayer1 * nFeatures, 1.0 / std::sqrt(nFeatures), opt.rng);
+    mwLayer1.assign(wLayer1.size(), 0.0);
+    rwLayer1.assign(wLayer1.size(), 0.0);
+    bLayer1.assign(nLayer1, 0.0);
+    mbLayer1.assign(nLayer1, 0.0);
+    rbLayer1.assign(nLayer1, 0.0);
+
+    wLayer2 = randn(nLayer2 * nLayer1, 1.0 / std::sqrt(nLayer1), opt.rng);
+    mwLayer2.assign(wLayer2.size(), 0.0);
+    rwLayer2.assign(wLayer2.size(), 0.0);
+    bLayer2.assign(nLayer2, 0.0);
+    mbLayer2.assign(nLayer2, 0.0);
+    rbLayer2.assign(nLayer2, 0.0);
+
+    wOutput = randn(nLayer2, 1.0 / std::sqrt(nLayer2), opt.rng);
+    mwOutput.assign(nLayer2, 0.0);
+    rwOutput.assign(nLayer2, 0.0);
     bOutput = 0.0;
     mbOutput = 0.0;
     rbOutput = 0.0;
+
+    current.wLayer1T.resize(wLayer1.size());
+    current.wLayer2T.resize(wLayer2.size());
+    current.losses.reserve(snapshotInterval);
+    refreshSnapshot();
+
+    features.resize(nFeatures);
+    trainActivations.resize(nMiniBatch);
+    inferActivations.resize(std::max(1, nChildren));
+    gvOutput.resize(nMiniBatch);
+    gwOutput.resize(nLayer2);
+    gvLayer2.resize(nMiniBatch * nLayer2);
+    gbLayer2.resize(nLayer2);
+    gwLayer2.resize(wLayer2.size());
+    gvPwlLayer1.resize(nMiniBatch * nLayer1);
+    gvLayer1.resize(nMiniBatch * nLayer1);
+    gbLayer1.resize(nLayer1);
+    gwLayer1.resize(wLayer1.size());
   }
 
-  void Net::appendTrajectory(const Sample &sample) {
-    ++trajectoryLength;
-    if (pool.size() == nPool)
-      pool[writePos].first = extractFeatures(sample);
-    else
-      pool.emplace_back(extractFeatures(sample), 0.0);
+  Net::~Net() {
+#ifndef __EMSCRIPTEN__
+    if (async)
+      stopTrainer();
+#endif
+  }
+
+  void Net::refreshSnapshot() {
+    transpose(nLayer1, nFeatures, wLayer1.data(), current.wLayer1T.data());
+    transpose(nLayer2, nLayer1, wLayer2.data(), current.wLayer2T.data());
+    current.bLayer1 = bLayer1;
+    current.bLayer2 = bLayer2;
+    current.wOutput = wOutput;
+    current.bOutput = bOutput;
+  }
+
+  int Net::storeRow(const double *row) {
+    if (poolTarget.size() < nPool) {
+      // Grow by doubling, but never past nPool rows.
+      if (poolTarget.size() == poolTarget.capacity()) {
+        std::size_t rows(std::min<std::size_t>(nPool, std::max<std::size_t>(poolMinRows, poolTarget.size() * 2)));
+        poolFeatures.reserve(rows * nFeatures);
+        poolTarget.reserve(rows);
+      }
+      poolFeatures.resize(poolFeatures.size() + nFeatures);
+      poolTarget.push_back(0.0);
+    }
+    int result(writePos);
+    std::copy(row, row + nFeatures, poolFeatures.begin() + static_cast<std::size_t>(result) * nFeatures);
     if (++writePos == nPool)
       writePos = 0;
+    return result;
+  }
+
+  void Net::newTrajectory() {
+    trajectoryLength = 0;
+#ifndef __EMSCRIPTEN__
+    pending.clear();
+#endif
+  }
+
+  void Net::appendTrajectory(const Sample &sample) {
+    ++trajectoryLength;
+    extractFeatures(sample, features.data());
+#ifndef __EMSCRIPTEN__
+    if (async) {
+      pending.insert(pending.end(), features.begin(), features.end());
+      return;
+    }
+#endif
+    storeRow(features.data());
   }
 
   void Net::finishTrajectory(double target) {
+#ifndef __EMSCRIPTEN__
+    if (async) {
+      {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        queue.push_back({std::move(pending), target});
+      }
+      queueReady.notify_one();
+      pending.clear();
+      return;
+    }
+#endif
     int pos(writePos);
     for (int i{}; i < trajectoryLength; ++i) {
       if (--pos < 0)
         pos = nPool - 1;
-      pool[pos].second = target;
+      poolTarget[pos] = target;
     }
   }
 
-  xt::xtensor<double, 1> Net::extractFeatures(const Sample &sample) {
-    xt::xtensor<double, 1> vInput(xt::zeros<double>({nFeatures}));
-    for (int x{}; x < opt.settings.sizeX; ++x)
-      for (int y{}; y < opt.settings.sizeY; ++y)
-        for (int z{}; z < opt.settings.sizeZ; ++z)
-          ++vInput[tileMap[sample.state(x, y, z)]];
-    for (auto &[x, y, z] : sample.value.invalidTiles)
-      ++vInput[tileMap.size() + tileMap[sample.state(x, y, z)]];
-    vInput.periodic(-1) = sample.value.fuelCellMultiplier;
-    vInput.periodic(-2) = sample.value.moderatorCellMultiplier;
-    vInput.periodic(-3) = sample.value.cooling / opt.settings.fuelBaseHeat;
-    vInput /= opt.settings.sizeX * opt.settings.sizeY * opt.settings.sizeZ;
-    vInput.periodic(-4) = sample.value.dutyCycle;
-    vInput.periodic(-5) = sample.value.efficiency;
-    return vInput;
+  void Net::extractFeatures(const Sample &sample, double *result) {
+    std::fill(result, result + nFeatures, 0.0);
+    for (int i{}; i <= Air; ++i)
+      if (tileMap[i] >= 0)
+        result[tileMap[i]] = sample.tileCounts[i];
+    for (int i : sample.value.invalidTiles)
+      ++result[nTiles + tileMap[sample.state[i]]];
+    result[nFeatures - 1] = sample.value.fuelCellMultiplier;
+    result[nFeatures - 2] = sample.value.moderatorCellMultiplier;
+    result[nFeatures - 3] = sample.value.cooling / opt.settings.fuelBaseHeat;
+    const double volume(opt.settings.sizeX * opt.settings.sizeY * opt.settings.sizeZ);
+    for (int i{}; i < nFeatures; ++i)
+      result[i] /= volume;
+    result[nFeatures - 4] = sample.value.dutyCycle;
+    result[nFeatures - 5] = sample.value.efficiency;
+  }
+
+  void Net::forward(const Snapshot &snapshot, Activations &activations, int nRows, const double *input) {
+    auto layer([&](int nIn, int nOut, const double *in, const double *wT, const std::vector<double> &b, double *v, double *pwl) {
+      multiply(nRows, nOut, nIn, in, wT, v);
+      for (int i{}; i < nRows * nOut; ++i) {
+        v[i] += b[i % nOut];
+        pwl[i] = v[i] * leak + std::clamp(v[i], -1.0, 1.0);
+      }
+    });
+    layer(nFeatures, nLayer1, input, snapshot.wLayer1T.data(), snapshot.bLayer1,
+      activations.vLayer1.data(), activations.vPwlLayer1.data());
+    layer(nLayer1, nLayer2, activations.vPwlLayer1.data(), snapshot.wLayer2T.data(), snapshot.bLayer2,
+      activations.vLayer2.data(), activations.vPwlLayer2.data());
+    for (int i{}; i < nRows; ++i) {
+      double sum{};
+      for (int j{}; j < nLayer2; ++j)
+        sum += snapshot.wOutput[j] * activations.vPwlLayer2[i * nLayer2 + j];
+      activations.vOutput[i] = snapshot.bOutput + sum;
+    }
   }
 
   double Net::infer(const Sample &sample) {
-    auto vInput(extractFeatures(sample));
-    xt::xtensor<double, 1> vLayer1(bLayer1 + xt::sum(wLayer1 * vInput, -1));
-    xt::xtensor<double, 1> vPwlLayer1(vLayer1 * leak + xt::clip(vLayer1, -1.0, 1.0));
-    xt::xtensor<double, 1> vLayer2(bLayer2 + xt::sum(wLayer2 * vPwlLayer1, -1));
-    xt::xtensor<double, 1> vPwlLayer2(vLayer2 * leak + xt::clip(vLayer2, -1.0, 1.0));
-    return bOutput + xt::sum(wOutput * vPwlLayer2)();
+    extractFeatures(sample, features.data());
+    forward(*inferSnapshot, inferActivations, 1, features.data());
+    return inferActivations.vOutput[0];
+  }
+
+  void Net::setInferRow(int row, const Sample &sample) {
+    extractFeatures(sample, inferInput.data() + row * nFeatures);
+  }
+
+  void Net::inferBatch(int nRows, double *result) {
+    forward(*inferSnapshot, inferActivations, nRows, inferInput.data());
+    std::copy(inferActivations.vOutput.begin(), inferActivations.vOutput.begin() + nRows, result);
   }
 
   double Net::train() {
+    return trainStep(opt.rng);
+  }
+
+  double Net::trainStep(std::mt19937 &rng) {
     // Assemble batch
-    std::uniform_int_distribution<size_t> dist(0, pool.size() - 1);
+    std::uniform_int_distribution<size_t> dist(0, poolTarget.size() - 1);
     for (int i{}; i < nMiniBatch; ++i) {
-      auto const &[features, target] = pool[dist(opt.rng)];
-      xt::view(batchInput, i, xt::all()) = features;
-      batchTarget(i) = target;
+      std::size_t row(dist(rng));
+      auto begin(poolFeatures.begin() + row * nFeatures);
+      std::copy(begin, begin + nFeatures, batchInput.begin() + i * nFeatures);
+      batchTarget[i] = poolTarget[row];
     }
 
     // Forward
-    xt::xtensor<double, 2> vLayer1(bLayer1 + xt::sum(wLayer1 * xt::view(batchInput, xt::all(), xt::newaxis(), xt::all()), -1));
-    xt::xtensor<double, 2> vPwlLayer1(vLayer1 * leak + xt::clip(vLayer1, -1.0, 1.0));
-    xt::xtensor<double, 2> vLayer2(bLayer2 + xt::sum(wLayer2 * xt::view(vPwlLayer1, xt::all(), xt::newaxis(), xt::all()), -1));
-    xt::xtensor<double, 2> vPwlLayer2(vLayer2 * leak + xt::clip(vLayer2, -1.0, 1.0));
-    xt::xtensor<double, 1> vOutput(bOutput + xt::sum(wOutput * vPwlLayer2, -1));
-    xt::xtensor<double, 1> losses(xt::square(vOutput - batchTarget));
-    double loss(xt::mean(losses)());
+    forward(current, trainActivations, nMiniBatch, batchInput.data());
+    auto &[vLayer1, vPwlLayer1, vLayer2, vPwlLayer2, vOutput](trainActivations);
+    double loss{};
+    for (int i{}; i < nMiniBatch; ++i)
+      loss += (vOutput[i] - batchTarget[i]) * (vOutput[i] - batchTarget[i]);
+    loss /= nMiniBatch;
 
     // Backward
-    xt::xtensor<double, 1> gvOutput((vOutput - batchTarget) * 2 / nMiniBatch);
-    double gbOutput(xt::sum(gvOutput)());
-    xt::xtensor<double, 1> gwOutput(xt::sum(xt::view(gvOutput, xt::all(), xt::newaxis()) * vPwlLayer2, 0));
-    xt::xtensor<double, 2> gvPwlLayer2(xt::empty_like(vPwlLayer2));
-    for (int i{}; i < nMiniBatch; ++i)
-      for (int j{}; j < nLayer2; ++j)
-        gvPwlLayer2(i, j) = gvOutput(i) * wOutput(j);
-    xt::xtensor<double, 2> gvLayer2(gvPwlLayer2 * (leak + (xt::abs(vLayer2) < 1.0)));
-    xt::xtensor<double, 1> gbLayer2(xt::sum(gvLayer2, 0));
-    xt::xtensor<double, 2> gwLayer2(xt::empty_like(wLayer2));
-    for (int i{}; i < nLayer2; ++i)
-      for (int j{}; j < nLayer1; ++j)
-        gwLayer2(i, j) = xt::sum(xt::view(gvLayer2, xt::all(), i) * xt::view(vPwlLayer1, xt::all(), j))();
-    xt::xtensor<double, 2> gvPwlLayer1(xt::sum(xt::view(gvLayer2, xt::all(), xt::all(), xt::newaxis()) * wLayer2, -2));
-    xt::xtensor<double, 2> gvLayer1(gvPwlLayer1 * (leak + (xt::abs(vLayer1) < 1.0)));
-    xt::xtensor<double, 1> gbLayer1(xt::sum(gvLayer1, 0));
-    xt::xtensor<double, 2> gwLayer1(xt::empty_like(wLayer1));
-    for (int i{}; i < nLayer1; ++i)
-      for (int j{}; j < nFeatures; ++j)
-        gwLayer1(i, j) = xt::sum(xt::view(gvLayer1, xt::all(), i) * xt::view(batchInput, xt::all(), j))();
+    double gbOutput{};
+    std::fill(gwOutput.begin(), gwOutput.end(), 0.0);
+    std::fill(gbLayer2.begin(), gbLayer2.end(), 0.0);
+    for (int i{}; i < nMiniBatch; ++i) {
+      gvOutput[i] = (vOutput[i] - batchTarget[i]) * 2 / nMiniBatch;
+      gbOutput += gvOutput[i];
+      for (int j{}; j < nLayer2; ++j) {
+        int k(i * nLayer2 + j);
+        gwOutput[j] += gvOutput[i] * vPwlLayer2[k];
+        gvLayer2[k] = gvOutput[i] * wOutput[j] * (leak + (std::abs(vLayer2[k]) < 1.0));
+        gbLayer2[j] += gvLayer2[k];
+      }
+    }
+    multiplyTransposed(nLayer2, nLayer1, nMiniBatch, gvLayer2.data(), vPwlLayer1.data(), gwLayer2.data());
+    multiply(nMiniBatch, nLayer1, nLayer2, gvLayer2.data(), wLayer2.data(), gvPwlLayer1.data());
+    std::fill(gbLayer1.begin(), gbLayer1.end(), 0.0);
+    for (int i{}; i < nMiniBatch * nLayer1; ++i) {
+      gvLayer1[i] = gvPwlLayer1[i] * (leak + (std::abs(vLayer1[i]) < 1.0));
+      gbLayer1[i % nLayer1] += gvLayer1[i];
+    }
+    multiplyTransposed(nLayer1, nFeatures, nMiniBatch, gvLayer1.data(), batchInput.data(), gwLayer1.data());
 
     // Adam
     mCorrector *= mRate;
-    mwLayer1 = mRate * mwLayer1 + (1 - mRate) * gwLayer1;
-    mbLayer1 = mRate * mbLayer1 + (1 - mRate) * gbLayer1;
-    mwLayer2 = mRate * mwLayer2 + (1 - mRate) * gwLayer2;
-    mbLayer2 = mRate * mbLayer2 + (1 - mRate) * gbLayer2;
-    mwOutput = mRate * mwOutput + (1 - mRate) * gwOutput;
-    mbOutput = mRate * mbOutput + (1 - mRate) * gbOutput;
-
     rCorrector *= rRate;
-    rwLayer1 = rRate * rwLayer1 + (1 - rRate) * xt::square(gwLayer1);
-    rbLayer1 = rRate * rbLayer1 + (1 - rRate) * xt::square(gbLayer1);
-    rwLayer2 = rRate * rwLayer2 + (1 - rRate) * xt::square(gwLayer2);
-    rbLayer2 = rRate * rbLayer2 + (1 - rRate) * xt::square(gbLayer2);
-    rwOutput = rRate * rwOutput + (1 - rRate) * xt::square(gwOutput);
-    rbOutput = rRate * rbOutput + (1 - rRate) * (gbOutput * gbOutput);
-
-    wLayer1 -= lRate * mwLayer1 / ((1 - mCorrector) * (xt::sqrt(rwLayer1 / (1 - rCorrector)) + 1e-8));
-    bLayer1 -= lRate * mbLayer1 / ((1 - mCorrector) * (xt::sqrt(rbLayer1 / (1 - rCorrector)) + 1e-8));
-    wLayer2 -= lRate * mwLayer2 / ((1 - mCorrector) * (xt::sqrt(rwLayer2 / (1 - rCorrector)) + 1e-8));
-    bLayer2 -= lRate * mbLayer2 / ((1 - mCorrector) * (xt::sqrt(rbLayer2 / (1 - rCorrector)) + 1e-8));
-    wOutput -= lRate * mwOutput / ((1 - mCorrector) * (xt::sqrt(rwOutput / (1 - rCorrector)) + 1e-8));
-    bOutput -= lRate * mbOutput / ((1 - mCorrector) * (std::sqrt(rbOutput / (1 - rCorrector)) + 1e-8));
+    adam(wLayer1.size(), mCorrector, rCorrector, gwLayer1.data(), mwLayer1.data(), rwLayer1.data(), wLayer1.data());
+    adam(bLayer1.size(), mCorrector, rCorrector, gbLayer1.data(), mbLayer1.data(), rbLayer1.data(), bLayer1.data());
+    adam(wLayer2.size(), mCorrector, rCorrector, gwLayer2.data(), mwLayer2.data(), rwLayer2.data(), wLayer2.data());
+    adam(bLayer2.size(), mCorrector, rCorrector, gbLayer2.data(), mbLayer2.data(), rbLayer2.data(), bLayer2.data());
+    adam(wOutput.size(), mCorrector, rCorrector, gwOutput.data(), mwOutput.data(), rwOutput.data(), wOutput.data());
+    adam(1, mCorrector, rCorrector, &gbOutput, &mbOutput, &rbOutput, &bOutput);
+    refreshSnapshot();
 
     return loss;
   }
+
+  bool Net::acquireSnapshot() {
+    if (!async || !(middle.load(std::memory_order_relaxed) & freshSlot))
+      return false;
+    front = middle.exchange(front, std::memory_order_acq_rel) & slotMask;
+    inferSnapshot = &slots[front];
+    return true;
+  }
+
+#ifndef __EMSCRIPTEN__
+  void Net::setAsync(bool enabled) {
+    if (enabled == async)
+      return;
+    if (enabled) {
+      // Until something is trained, the pool holds no more than the unfinished trajectory.
+      pending.clear();
+      if (static_cast<int>(poolTarget.size()) == trajectoryLength && writePos == trajectoryLength) {
+        pending.assign(poolFeatures.begin(), poolFeatures.end());
+        poolFeatures.clear();
+        poolTarget.clear();
+        writePos = 0;
+      } else {
+        trajectoryLength = 0;
+      }
+      for (auto &slot : slots)
+        slot = current;
+      front = 0;
+      back = 1;
+      middle.store(2);
+      inferSnapshot = &slots[front];
+      trainRng.seed(std::uniform_int_distribution<std::uint32_t>()(opt.rng));
+      stopping = false;
+      async = true;
+      trainer = std::thread(&Net::trainLoop, this);
+    } else {
+      stopTrainer();
+      // What the trainer has not taken yet goes to the pool untrained, the unfinished trajectory last.
+      for (auto &trajectory : queue)
+        storeTrajectory(trajectory);
+      queue.clear();
+      for (std::size_t i{}; i < pending.size(); i += nFeatures)
+        storeRow(pending.data() + i);
+      pending.clear();
+      current.losses.clear();
+      inferSnapshot = &current;
+      async = false;
+    }
+  }
+
+  void Net::stopTrainer() {
+    {
+      std::lock_guard<std::mutex> lock(queueMutex);
+      stopping = true;
+    }
+    queueReady.notify_one();
+    trainer.join();
+  }
+
+  int Net::storeTrajectory(const Trajectory &trajectory) {
+    int nRows(static_cast<int>(trajectory.features.size()) / nFeatures);
+    for (int i{}; i < nRows; ++i)
+      poolTarget[storeRow(trajectory.features.data() + i * nFeatures)] = trajectory.target;
+    return (nRows * nEpoch + nMiniBatch - 1) / nMiniBatch;
+  }
+
+  void Net::trainLoop() {
+    std::vector<Trajectory> batch;
+    for (;;) {
+      {
+        std::unique_lock<std::mutex> lock(queueMutex);
+        queueReady.wait(lock, [this] { return stopping || !queue.empty(); });
+        if (stopping)
+          return;
+        batch.assign(std::make_move_iterator(queue.begin()), std::make_move_iterator(queue.end()));
+        queue.clear();
+      }
+      // As many steps as training between episodes would spend on these trajectories, capped so that
+      // a trainer slower than the search keeps to a growing pool instead of falling ever further behind.
+      int nSteps{};
+      {
+        std::lock_guard<std::mutex> lock(stateMutex);
+        for (auto &trajectory : batch)
+          nSteps += storeTrajectory(trajectory);
+      }
+      nSteps = std::min(nSteps, maxAsyncSteps);
+      for (int i{}; i < nSteps && !stopping; ++i) {
+        std::lock_guard<std::mutex> lock(stateMutex);
+        current.losses.push_back(trainStep(trainRng));
+        if (current.losses.size() == snapshotInterval || i == nSteps - 1)
+          publish();
+      }
+    }
+  }
+
+  void Net::publish() {
+    slots[back] = current;
+    current.losses.clear();
+    back = middle.exchange(back | freshSlot, std::memory_order_acq_rel) & slotMask;
+  }
+#endif
+
+  void Net::save(CheckpointWriter &out) const {
+#ifndef __EMSCRIPTEN__
+    std::unique_lock<std::mutex> lock(stateMutex, std::defer_lock);
+    if (async)
+      lock.lock();
+#endif
+    out.value(nFeatures);
+    out.value(mCorrector);
+    out.value(rCorrector);
+    // Rows of the unfinished trajectory are only in the pool without a background trainer.
+    out.value(async ? 0 : trajectoryLength);
+    out.value(writePos);
+    for (auto tensor : {&wLayer1, &mwLayer1, &rwLayer1, &wLayer2, &mwLayer2, &rwLayer2})
+      out.array(tensor->data(), tensor->size());
+    for (auto tensor : {&bLayer1, &mbLayer1, &rbLayer1, &bLayer2, &mbLayer2, &rbLayer2, &wOutput, &mwOutput, &rwOutput})
+      out.array(tensor->data(), tensor->size());
+    out.value(bOutput);
+    out.value(mbOutput);
+    out.value(rbOutput);
+    out.array(poolFeatures.data(), poolFeatures.size());
+    out.array(poolTarget.data(), poolTarget.size());
+  }
+
+  void Net::load(CheckpointReader &in) {
+#ifndef __EMSCRIPTEN__
+    std::unique_lock<std::mutex> lock(stateMutex, std::defer_lock);
+    if (async) {
+      lock.lock();
+      std::lock_guard<std::mutex> queueLock(queueMutex);
+      queue.clear();
+    }
+#endif
+    in.expect(in.value<int>() == nFeatures, "net features");
+    mCorrector = in.value<double>();
+    rCorrector = in.value<double>();
+    trajectoryLength = in.value<int>();
+    writePos = in.value<int>();
+    for (auto tensor : {&wLayer1, &mwLayer1, &rwLayer1, &wLayer2, &mwLayer2, &rwLayer2})
+      in.array(tensor->data(), tensor->size());
+    for (auto tensor : {&bLayer1, &mbLayer1, &rbLayer1, &bLayer2, &mbLayer2, &rbLayer2, &wOutput, &mwOutput, &rwOutput})
+      in.array(tensor->data(), tensor->size());
+    bOutput = in.value<double>();
+    mbOutput = in.value<double>();
+    rbOutput = in.value<double>();
+    std::uint64_t nValues(in.arrayHeader());
+    in.expect(nValues % nFeatures == 0 && nValues / nFeatures <= nPool, "net pool");
+    poolFeatures.resize(nValues);
+    in.raw(poolFeatures.data(), poolFeatures.size() * sizeof(float));
+    poolTarget.resize(nValues / nFeatures);
+    in.array(poolTarget.data(), poolTarget.size());
+    refreshSnapshot();
+#ifndef __EMSCRIPTEN__
+    if (async) {
+      // The loaded weights replace those of the search, and a snapshot still in middle is stale.
+      pending.clear();
+      trajectoryLength = 0;
+      current.losses.clear();
+      slots[front] = current;
+      middle.store(middle.load() & slotMask);
+    }
+#endif
+  }
 }
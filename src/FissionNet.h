@@ -1,40 +1,134 @@
 #ifndef _FISSION_NET_H_
 #define _FISSION_NET_H_
-#include <unordered_map>
+#include <atomic>
+#ifndef __EMSCRIPTEN__
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#endif
 #include "OptFission.h"
 
 namespace Fission {
   constexpr int nStatisticalFeatures(5), nLayer1(128), nLayer2(64), nMiniBatch(64), nEpoch(2), nPool(1'000'000);
   constexpr double lRate(0.01), mRate(0.9), rRate(0.999), leak(0.1);
 
+  // Matrices are row-major in flat vectors and run through the kernels of FissionLinalg.h; every
+  // buffer is sized once, so inference and training do not allocate.
   class Net {
+    // Weights as the forward pass reads them, [inputs x outputs], with the losses of the training
+    // steps that led to them since the previous snapshot was published.
+    struct Snapshot {
+      std::vector<double> wLayer1T, bLayer1, wLayer2T, bLayer2, wOutput;
+      double bOutput;
+      std::vector<double> losses;
+    };
+    // Outputs of each layer, for up to as many rows as they were sized for.
+    struct Activations {
+      std::vector<double> vLayer1, vPwlLayer1, vLayer2, vPwlLayer2, vOutput;
+      void resize(int nRows);
+    };
+
     Opt &opt;
     double mCorrector, rCorrector;
-    std::unordered_map<int, int> tileMap;
-    int nFeatures;
+    // Feature of each tile kind, or -1 for kinds the limits rule out; nTiles kinds are used.
+    std::array<int, TileCount + 1> tileMap;
+    int nTiles, nFeatures;
 
-    // Data Pool
-    xt::xtensor<double, 2> batchInput;
-    xt::xtensor<double, 1> batchTarget;
-    std::vector<std::pair<xt::xtensor<double, 1>, double>> pool;
+    // Data Pool: a ring buffer of up to nPool rows written at writePos. The features are one
+    // row-major single precision block, converted back to double when a minibatch is gathered.
+    std::vector<double> batchInput, batchTarget;
+    // Features of the samples staged for inferBatch, one row per child of a step.
+    std::vector<double> inferInput;
+    std::vector<float> poolFeatures;
+    std::vector<double> poolTarget;
     int trajectoryLength, writePos;
 
-    xt::xtensor<double, 2> wLayer1, mwLayer1, rwLayer1;
-    xt::xtensor<double, 1> bLayer1, mbLayer1, rbLayer1;
-    xt::xtensor<double, 2> wLayer2, mwLayer2, rwLayer2;
-    xt::xtensor<double, 1> bLayer2, mbLayer2, rbLayer2;
-    xt::xtensor<double, 1> wOutput, mwOutput, rwOutput;
+    // Weights are [outputs x inputs], each with its Adam moments.
+    std::vector<double> wLayer1, mwLayer1, rwLayer1;
+    std::vector<double> bLayer1, mbLayer1, rbLayer1;
+    std::vector<double> wLayer2, mwLayer2, rwLayer2;
+    std::vector<double> bLayer2, mbLayer2, rbLayer2;
+    std::vector<double> wOutput, mwOutput, rwOutput;
     double bOutput, mbOutput, rbOutput;
+    // The weights above for the forward pass, refreshed whenever they change.
+    Snapshot current;
+
+    // Training has activations of its own, so that a background trainer leaves inference alone.
+    std::vector<double> features;
+    Activations trainActivations, inferActivations;
+    std::vector<double> gvOutput, gwOutput, gvLayer2, gbLayer2, gwLayer2, gvPwlLayer1, gvLayer1, gbLayer1, gwLayer1;
 
-    xt::xtensor<double, 1> extractFeatures(const Sample &sample);
+    // Weights inference reads: current, or the latest snapshot taken from the background trainer.
+    const Snapshot *inferSnapshot;
+    bool async;
+    // Snapshots on their way from the trainer to the search, triple buffered so that neither side
+    // waits: the trainer fills slot back and swaps it into middle, marked fresh, and the search
+    // swaps its slot front with middle whenever that is fresh.
+    std::array<Snapshot, 3> slots;
+    std::atomic<int> middle;
+    int back, front;
+#ifndef __EMSCRIPTEN__
+    // Background training. Finished trajectories queue up for the trainer, which stores them in
+    // the pool and trains on it, holding stateMutex whenever it touches the weights or the pool.
+    struct Trajectory {
+      std::vector<double> features;
+      double target;
+    };
+    // Rows of the unfinished trajectory, kept by the search until it has a target.
+    std::vector<double> pending;
+    std::deque<Trajectory> queue;
+    std::mutex queueMutex;
+    std::condition_variable queueReady;
+    mutable std::mutex stateMutex;
+    std::atomic<bool> stopping;
+    std::mt19937 trainRng;
+    std::thread trainer;
+    // Stores the rows of a trajectory in the pool and returns the training steps they call for.
+    int storeTrajectory(const Trajectory &trajectory);
+    void trainLoop();
+    void publish();
+    void stopTrainer();
+#endif
+
+    // Reads the tile counts of the sample rather than its state, so this is linear only in its invalid tiles.
+    void extractFeatures(const Sample &sample, double *result);
+    // Stores a row of features at writePos and returns its index in the pool.
+    int storeRow(const double *row);
+    // Runs the layers on nRows rows of features; the predictions land in activations.vOutput.
+    void forward(const Snapshot &snapshot, Activations &activations, int nRows, const double *input);
+    double trainStep(std::mt19937 &rng);
+    void refreshSnapshot();
   public:
     explicit Net(Opt &opt);
+    ~Net();
     double infer(const Sample &sample);
-    void newTrajectory() { trajectoryLength = 0; }
+    // Stages the features of a sample as row of the next inferBatch, for rows below the child count of opt.
+    void setInferRow(int row, const Sample &sample);
+    // Scores the staged rows [0, nRows) in one pass through the layers.
+    void inferBatch(int nRows, double *result);
+    void newTrajectory();
     void appendTrajectory(const Sample &sample);
+    // Sets the target of the trajectory, or hands it to the background trainer.
     void finishTrajectory(double target);
     int getTrajectoryLength() const { return trajectoryLength; }
     double train();
+    bool isAsync() const { return async; }
+#ifndef __EMSCRIPTEN__
+    // Moves training to a background thread that learns from each finished trajectory, or back.
+    // Call before stepping: an unfinished trajectory only carries over while nothing is trained.
+    void setAsync(bool enabled);
+#endif
+    // Switches inference to the newest snapshot of the background trainer if there is one, whose
+    // training losses are then in getSnapshotLosses.
+    bool acquireSnapshot();
+    const std::vector<double> &getSnapshotLosses() const { return inferSnapshot->losses; }
+    std::size_t getPoolRows() const { return poolTarget.size(); }
+    std::size_t getPoolBytes() const { return poolFeatures.capacity() * sizeof(float) + poolTarget.capacity() * sizeof(double); }
+    // Weights, Adam moments and the training pool. Trajectories the background trainer has not
+    // stored yet are left out.
+    void save(CheckpointWriter &out) const;
+    void load(CheckpointReader &in);
   };
 }
 
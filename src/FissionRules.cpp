@@ -0,0 +1,158 @@
+#include <stdexcept>
+#include "Fission.h"
+
+namespace Fission {
+  namespace {
+    constexpr int Cell = static_cast<int>(Tile::Cell);
+    constexpr int Moderator = static_cast<int>(Tile::Moderator);
+    constexpr int Casing = static_cast<int>(Tile::Casing);
+
+    struct SinkName {
+      const char *type;
+      Tile tile;
+    };
+
+    constexpr SinkName sinkNames[] {
+      {"water", Tile::Water}, {"copper", Tile::Copper}, {"cryotheum", Tile::Cryotheum},
+      {"enderium", Tile::Enderium}, {"redstone", Tile::Redstone}, {"liquid_helium", Tile::Helium},
+      {"boron", Tile::Boron}, {"lapis", Tile::Lapis}, {"emerald", Tile::Emerald},
+      {"quartz", Tile::Quartz}, {"tin", Tile::Tin}, {"aluminum", Tile::Aluminium},
+      {"magnesium", Tile::Magnesium}, {"manganese", Tile::Manganese}, {"glowstone", Tile::Glowstone}
+    };
+
+    // Same as config/heat_sinks.
+    struct StockRule {
+      Tile tile;
+      std::vector<std::string> placementRule;
+    };
+
+    const StockRule stockRules[] {
+      {Tile::Water, {"fission_reactor_solid_fuel_cell|#nuclearcraft:moderators"}},
+      {Tile::Copper, {"glowstone_heat_sink"}},
+      {Tile::Cryotheum, {"fission_reactor_solid_fuel_cell>2", "#nuclearcraft:moderators"}},
+      {Tile::Enderium, {"#nuclearcraft:fission_reactor_casing^3"}},
+      {Tile::Redstone, {"fission_reactor_solid_fuel_cell"}},
+      {Tile::Helium, {"redstone_heat_sink", "#nuclearcraft:fission_reactor_casing"}},
+      {Tile::Boron, {"quartz_heat_sink", "#nuclearcraft:fission_reactor_casing|#nuclearcraft:moderators"}},
+      {Tile::Lapis, {"fission_reactor_solid_fuel_cell", "#nuclearcraft:fission_reactor_casing"}},
+      {Tile::Emerald, {"fission_reactor_solid_fuel_cell", "#nuclearcraft:moderators"}},
+      {Tile::Quartz, {"#nuclearcraft:moderators"}},
+      {Tile::Tin, {"lapis_heat_sink-2"}},
+      {Tile::Aluminium, {"quartz_heat_sink", "lapis_heat_sink"}},
+      {Tile::Magnesium, {"#nuclearcraft:fission_reactor_casing", "#nuclearcraft:moderators"}},
+      {Tile::Manganese, {"fission_reactor_solid_fuel_cell>2"}},
+      {Tile::Glowstone, {"#nuclearcraft:moderators>2"}}
+    };
+
+    int parseTarget(const std::string &name) {
+      if (name == "fission_reactor_solid_fuel_cell")
+        return Cell;
+      if (name == "#nuclearcraft:moderators")
+        return Moderator;
+      if (name == "#nuclearcraft:fission_reactor_casing")
+        return Casing;
+      const std::string suffix("_heat_sink");
+      if (name.size() > suffix.size() && !name.compare(name.size() - suffix.size(), suffix.size(), suffix))
+        return PlacementRules::parseSinkType(name.substr(0, name.size() - suffix.size()));
+      throw std::runtime_error("Unknown placement rule target: " + name);
+    }
+  }
+
+  bool PlacementRules::Term::operator==(const Term &other) const {
+    return requirement == other.requirement && target == other.target
+      && count == other.count && lastInClause == other.lastInClause;
+  }
+
+  PlacementRules::PlacementRules() {
+    for (auto &[tile, placementRule] : stockRules)
+      setRule(static_cast<int>(tile), placementRule);
+    compile();
+  }
+
+  int PlacementRules::parseSinkType(const std::string &type) {
+    for (auto &[name, tile] : sinkNames)
+      if (type == name)
+        return static_cast<int>(tile);
+    throw std::runtime_error("Unknown heat sink type: " + type);
+  }
+
+  PlacementRules::Term PlacementRules::parseTerm(const std::string &text) {
+    Term result{Requirement::AtLeast, 0, 1, false};
+    size_t split(text.find_last_of(">-^"));
+    std::string name(text.substr(0, split));
+    if (split != std::string::npos) {
+      int count;
+      try {
+        size_t idx{};
+        count = std::stoi(text.substr(split + 1), &idx);
+        if (idx != text.size() - split - 1)
+          throw std::invalid_argument(text);
+      } catch (const std::logic_error &) {
+        throw std::runtime_error("Invalid placement rule: " + text);
+      }
+      switch (text[split]) {
+        case '>':
+          if (count < 1 || count > 6)
+            throw std::runtime_error("Invalid neighbour count in placement rule: " + text);
+          break;
+        case '-':
+          if (count != 2)
+            throw std::runtime_error("Axial placement rules need exactly two neighbours: " + text);
+          result.requirement = Requirement::Axial;
+          break;
+        default:
+          if (count != 3)
+            throw std::runtime_error("Vertex placement rules need exactly three neighbours: " + text);
+          result.requirement = Requirement::Vertex;
+      }
+      result.count = static_cast<std::uint8_t>(count);
+    }
+    result.target = static_cast<std::uint8_t>(parseTarget(name));
+    return result;
+  }
+
+  void PlacementRules::setRule(int sink, const std::vector<std::string> &placementRule) {
+    auto &rule(rules[sink]);
+    rule.clear();
+    for (auto &text : placementRule) {
+      size_t begin{};
+      for (size_t end; (end = text.find('|', begin)) != std::string::npos; begin = end + 1)
+        rule.emplace_back(parseTerm(text.substr(begin, end - begin)));
+      rule.emplace_back(parseTerm(text.substr(begin)));
+      rule.back().lastInClause = true;
+    }
+  }
+
+  void PlacementRules::compile() {
+    program.clear();
+    for (int sink{}; sink < CoolerCount; ++sink) {
+      programBegin[sink] = static_cast<int>(program.size());
+      program.insert(program.end(), rules[sink].begin(), rules[sink].end());
+    }
+    programBegin[CoolerCount] = static_cast<int>(program.size());
+
+    // Each pass takes every sink whose referenced sink types all sit in earlier passes.
+    passes.fill(-1);
+    nPasses = 0;
+    for (int placed{}; placed < CoolerCount; ++nPasses) {
+      std::array<bool, CoolerCount> ready{};
+      for (int sink{}; sink < CoolerCount; ++sink) {
+        if (passes[sink] >= 0)
+          continue;
+        ready[sink] = true;
+        for (auto &term : rules[sink])
+          if (term.target < Cell && passes[term.target] < 0)
+            ready[sink] = false;
+      }
+      int before(placed);
+      for (int sink{}; sink < CoolerCount; ++sink) {
+        if (ready[sink]) {
+          passes[sink] = nPasses;
+          ++placed;
+        }
+      }
+      if (placed == before)
+        throw std::runtime_error("Heat sink placement rules depend on each other in a cycle");
+    }
+  }
+}
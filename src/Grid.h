@@ -0,0 +1,169 @@
+#ifndef _GRID_H_
+#define _GRID_H_
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <iterator>
+#include <tuple>
+#include <vector>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace Fission {
+  // Index arithmetic of a padded grid: linear index of a tile and the offsets of its
+  // -x, +x, -y, +y, -z, +z neighbours.
+  struct GridShape {
+    int sizeX, sizeY, sizeZ, strideX, strideY;
+    std::array<int, 6> offsets;
+
+    GridShape(int sizeX, int sizeY, int sizeZ)
+      :sizeX(sizeX), sizeY(sizeY), sizeZ(sizeZ), strideX((sizeY + 2) * (sizeZ + 2)), strideY(sizeZ + 2),
+      offsets{-strideX, strideX, -strideY, strideY, -1, 1} {}
+
+    int index(int x, int y, int z) const { return (x + 1) * strideX + (y + 1) * strideY + z + 1; }
+    int offset(int k) const { return offsets[k]; }
+  };
+
+  // GridShape of a size fixed at compile time, so that strides, offsets and trip counts are constants.
+  template <int X, int Y, int Z>
+  struct FixedGridShape {
+    static constexpr int sizeX = X, sizeY = Y, sizeZ = Z, strideX = (Y + 2) * (Z + 2), strideY = Z + 2;
+
+    static constexpr int index(int x, int y, int z) { return (x + 1) * strideX + (y + 1) * strideY + z + 1; }
+    static constexpr int offset(int k) { return (k & 1 ? 1 : -1) * (k < 2 ? strideX : k < 4 ? strideY : 1); }
+  };
+
+  // Core-sized volume stored in one linear buffer with a one-tile border on every side,
+  // so that neighbour lookups are plain offsets and never need bounds checks.
+  template <typename T>
+  class PaddedGrid {
+    int sizeX, sizeY, sizeZ, strideX, strideY;
+    std::vector<T> cells;
+  public:
+    PaddedGrid() :sizeX(), sizeY(), sizeZ(), strideX(), strideY() {}
+
+    PaddedGrid(int sizeX, int sizeY, int sizeZ, T value, T border)
+      :sizeX(sizeX), sizeY(sizeY), sizeZ(sizeZ), strideX((sizeY + 2) * (sizeZ + 2)), strideY(sizeZ + 2),
+      cells(static_cast<size_t>(sizeX + 2) * strideX, border) {
+      fillInterior(value);
+    }
+
+    int shape(int axis) const { return axis == 0 ? sizeX : axis == 1 ? sizeY : sizeZ; }
+    int size() const { return static_cast<int>(cells.size()); }
+    int index(int x, int y, int z) const { return (x + 1) * strideX + (y + 1) * strideY + z + 1; }
+    std::tuple<int, int, int> coords(int i) const { return {i / strideX - 1, i % strideX / strideY - 1, i % strideY - 1}; }
+    // Offsets of the -x, +x, -y, +y, -z, +z neighbours.
+    std::array<int, 6> neighborOffsets() const { return {-strideX, strideX, -strideY, strideY, -1, 1}; }
+
+    T &operator()(int x, int y, int z) { return cells[index(x, y, z)]; }
+    const T &operator()(int x, int y, int z) const { return cells[index(x, y, z)]; }
+    T &operator[](int i) { return cells[i]; }
+    const T &operator[](int i) const { return cells[i]; }
+    T *data() { return cells.data(); }
+    const T *data() const { return cells.data(); }
+
+    void fill(T value) { std::fill(cells.begin(), cells.end(), value); }
+
+    void fillInterior(T value) {
+      for (int x{}; x < sizeX; ++x)
+        for (int y{}; y < sizeY; ++y)
+          std::fill_n(cells.begin() + index(x, y, 0), sizeZ, value);
+    }
+
+    bool operator==(const PaddedGrid &other) const { return cells == other.cells; }
+    bool operator!=(const PaddedGrid &other) const { return cells != other.cells; }
+  };
+
+  // One bit per tile of a padded grid, in the same linear order.
+  // Resizing to an unchanged size and copying between equal sizes never touch the heap.
+  class TileMask {
+    std::vector<std::uint64_t> words;
+  public:
+    using Word = std::uint64_t;
+    static constexpr int WordBits = 64;
+
+    // Forward iterator over the linear indices of the set bits, in increasing order.
+    class Iterator {
+      const Word *word, *end;
+      Word bits;
+      int base;
+
+      void skipEmpty() {
+        while (!bits && ++word != end) {
+          bits = *word;
+          base += WordBits;
+        }
+      }
+    public:
+      using iterator_category = std::forward_iterator_tag;
+      using value_type = int;
+      using difference_type = std::ptrdiff_t;
+      using pointer = const int *;
+      using reference = int;
+
+      Iterator(const Word *word, const Word *end)
+        :word(word), end(end), bits(word != end ? *word : 0), base() {
+        if (word != end)
+          skipEmpty();
+      }
+
+      int operator*() const { return base + countTrailingZeros(bits); }
+      Iterator &operator++() { bits &= bits - 1; skipEmpty(); return *this; }
+      Iterator operator++(int) { Iterator result(*this); ++*this; return result; }
+      bool operator==(const Iterator &other) const { return word == other.word && bits == other.bits; }
+      bool operator!=(const Iterator &other) const { return !(*this == other); }
+    };
+
+    static int countTrailingZeros(Word bits) {
+#ifdef _MSC_VER
+      unsigned long result;
+      _BitScanForward64(&result, bits);
+      return static_cast<int>(result);
+#else
+      return __builtin_ctzll(bits);
+#endif
+    }
+
+    static int popCount(Word bits) {
+#ifdef _MSC_VER
+      return static_cast<int>(__popcnt64(bits));
+#else
+      return __builtin_popcountll(bits);
+#endif
+    }
+
+    // Sizes the mask for `tiles` linear indices and clears it.
+    void resize(int tiles) {
+      words.resize((tiles + WordBits - 1) / WordBits);
+      clear();
+    }
+
+    void clear() { std::fill(words.begin(), words.end(), 0); }
+    void set(int i) { words[i / WordBits] |= Word(1) << i % WordBits; }
+    void reset(int i) { words[i / WordBits] &= ~(Word(1) << i % WordBits); }
+    void assign(int i, bool value) { value ? set(i) : reset(i); }
+    bool test(int i) const { return words[i / WordBits] >> i % WordBits & 1; }
+
+    bool empty() const { return std::all_of(words.begin(), words.end(), [](Word w) { return !w; }); }
+    int count() const {
+      int result{};
+      for (Word w : words)
+        result += popCount(w);
+      return result;
+    }
+
+    int wordCount() const { return static_cast<int>(words.size()); }
+    Word *data() { return words.data(); }
+    const Word *data() const { return words.data(); }
+
+    Iterator begin() const { return {words.data(), words.data() + words.size()}; }
+    Iterator end() const { return {words.data() + words.size(), words.data() + words.size()}; }
+
+    bool operator==(const TileMask &other) const { return words == other.words; }
+    bool operator!=(const TileMask &other) const { return words != other.words; }
+  };
+}
+
+#endif
@@ -1,47 +1,270 @@
 #include "OptFission.h"
+#include <algorithm>
 #include <array>
+#include <stdexcept>
+#include <utility>
 #include <vector>
-#include <xtensor/xview.hpp>
+#include "Checkpoint.h"
 #include "FissionNet.h"
 
 namespace Fission {
   namespace {
+    constexpr int Cell = static_cast<int>(Tile::Cell);
+    constexpr int Moderator = static_cast<int>(Tile::Moderator);
     constexpr int Air = static_cast<int>(Tile::Air);
+    constexpr int Casing = static_cast<int>(Tile::Casing);
     constexpr int StageTrain = static_cast<int>(Stage::Train);
     constexpr int StageInfer = static_cast<int>(Stage::Infer);
     constexpr double HeatPositiveMaxFraction = 0.9;
+    // Mutator::construct: tiles sampled per placement, and placements in a row that may find nothing better.
+    constexpr int constructCandidates(16), constructPatience(3);
+    // Least share of free tiles construct counts on to become heat sinks, halving from one half.
+    constexpr double constructMinShare(1.0 / 16);
   }
 
-  void Opt::restart() {
+  Mutator::Mutator(const Settings &settings, const TranspositionTable &cache)
+    :settings(settings), cache(cache) {
+    for (int x(settings.symX ? settings.sizeX / 2 : 0); x < settings.sizeX; ++x)
+      for (int y(settings.symY ? settings.sizeY / 2 : 0); y < settings.sizeY; ++y)
+        for (int z(settings.symZ ? settings.sizeZ / 2 : 0); z < settings.sizeZ; ++z)
+          allowedCoords.emplace_back(x, y, z);
+    PlacementRules stockRules;
+    const PlacementRules &rules(settings.placementRules ? *settings.placementRules : stockRules);
+    for (int sink{}; sink < CoolerCount; ++sink)
+      if (settings.limit[sink] && settings.coolingRates[sink] > 0.0)
+        sinkOrder.emplace_back(sink);
+    std::stable_sort(sinkOrder.begin(), sinkOrder.end(), [&](int a, int b) {
+      if (rules.getPass(a) != rules.getPass(b))
+        return rules.getPass(a) < rules.getPass(b);
+      return settings.coolingRates[a] > settings.coolingRates[b];
+    });
+  }
+
+  void Mutator::clear(Sample &sample) const {
+    std::copy(settings.limit.begin(), settings.limit.end(), sample.limit.begin());
+    sample.state.fillInterior(Air);
+    sample.hash = 0;
+    sample.tileCounts.fill(0);
+    sample.tileCounts[Air] = settings.sizeX * settings.sizeY * settings.sizeZ;
+  }
+
+  void Mutator::randomize(Sample &sample, std::mt19937 &rng) {
     std::shuffle(allowedCoords.begin(), allowedCoords.end(), rng);
-    std::copy(settings.limit.begin(), settings.limit.end(), parent.limit.begin());
-    parent.state = xt::broadcast(Air,
-      {settings.sizeX, settings.sizeY, settings.sizeZ});
+    clear(sample);
     for (auto const &[x, y, z] : allowedCoords) {
       int nSym(getNSym(x, y, z));
       allowedTiles.clear();
       for (int tile{}; tile < Air; ++tile)
-        if (parent.limit[tile] < 0 || parent.limit[tile] >= nSym)
+        if (sample.limit[tile] < 0 || sample.limit[tile] >= nSym)
           allowedTiles.emplace_back(tile);
       if (allowedTiles.empty())
         break;
       int newTile(allowedTiles[std::uniform_int_distribution<>(0, static_cast<int>(allowedTiles.size() - 1))(rng)]);
-      parent.limit[newTile] -= nSym;
-      setTileWithSym(parent, x, y, z, newTile);
+      sample.limit[newTile] -= nSym;
+      setTileWithSym(sample, x, y, z, newTile);
     }
-    evaluator.run(parent.state, parent.value);
   }
 
-  Opt::Opt(const Settings &settings, bool useNet)
-    :settings(settings), evaluator(settings),
+  int Mutator::copyLayout(Sample &sample, const State &layout) const {
+    clear(sample);
+    int nDropped{};
+    for (auto const &[x, y, z] : allowedCoords) {
+      int tile(layout(x, y, z)), nSym(getNSym(x, y, z));
+      if (tile >= Air)
+        continue;
+      if (sample.limit[tile] >= 0 && sample.limit[tile] < nSym) {
+        nDropped += nSym;
+        continue;
+      }
+      sample.limit[tile] -= nSym;
+      setTileWithSym(sample, x, y, z, tile);
+    }
+    return nDropped;
+  }
+
+  void Mutator::construct(Sample &sample, Evaluator &evaluator, std::mt19937 &rng) {
+    for (double sinkShare(0.5);; sinkShare /= 2) {
+      construct(sample, evaluator, rng, sinkShare);
+      if (sample.value.netHeat <= 0.0 || sinkShare <= constructMinShare)
+        break;
+    }
+  }
+
+  void Mutator::construct(Sample &sample, Evaluator &evaluator, std::mt19937 &rng, double sinkShare) {
+    clear(sample);
+    evaluator.run(sample.state, sample.value);
+    State trial(sample.state);
+    Evaluation trialValue;
+    Coords changed;
+    int freeWeight{};
+    for (auto const &[x, y, z] : allowedCoords)
+      freeWeight += getNSym(x, y, z);
+    // A share of the free tiles is taken to end up as heat sinks of average rate.
+    double coolingPerTile{};
+    for (int sink : sinkOrder)
+      coolingPerTile += settings.coolingRates[sink];
+    if (!sinkOrder.empty())
+      coolingPerTile *= sinkShare / sinkOrder.size();
+    auto estimate([&](const Evaluation &x, int free) {
+      const double power(settings.fuelBasePower * (x.cellsEnergyMult + x.moderatorCellMultiplier * settings.modFEMult / 100.0));
+      const double cooling(free * coolingPerTile);
+      const double dutyCycle(x.heat > cooling ? cooling / x.heat : 1.0);
+      switch (settings.goal) {
+        default:
+          return power * dutyCycle;
+        case Goal::Breeder:
+          return x.breed * dutyCycle;
+        case Goal::Efficiency:
+          return x.breed ? power / (settings.fuelBasePower * x.breed) * dutyCycle : 0.0;
+      }
+    });
+
+    std::uniform_int_distribution<> coordDist(0, static_cast<int>(allowedCoords.size()) - 1);
+    double current(estimate(sample.value, freeWeight));
+    for (int nFailures{}; nFailures < constructPatience;) {
+      int bestCoord(-1), bestTile{};
+      double bestScore(current);
+      for (int i{}; i < constructCandidates; ++i) {
+        int coord(coordDist(rng));
+        auto const &[x, y, z](allowedCoords[coord]);
+        if (sample.state(x, y, z) != Air)
+          continue;
+        int nSym(getNSym(x, y, z));
+        getSymCoords(x, y, z, changed);
+        for (int tile : {Cell, Moderator}) {
+          if (sample.limit[tile] >= 0 && sample.limit[tile] < nSym)
+            continue;
+          for (auto const &[cx, cy, cz] : changed)
+            trial(cx, cy, cz) = tile;
+          evaluator.applyDelta(sample.state, sample.value, trial, changed, trialValue);
+          for (auto const &[cx, cy, cz] : changed)
+            trial(cx, cy, cz) = Air;
+          if (!trialValue.invalidTiles.empty())
+            continue;
+          double score(estimate(trialValue, freeWeight - nSym));
+          if (score > bestScore) {
+            bestCoord = coord;
+            bestTile = tile;
+            bestScore = score;
+          }
+        }
+      }
+      if (bestCoord < 0) {
+        ++nFailures;
+        continue;
+      }
+      nFailures = 0;
+      auto const &[x, y, z](allowedCoords[bestCoord]);
+      int nSym(getNSym(x, y, z));
+      sample.limit[bestTile] -= nSym;
+      setTileWithSym(sample, x, y, z, bestTile);
+      trial = sample.state;
+      freeWeight -= nSym;
+      current = bestScore;
+      evaluator.run(sample.state, sample.value);
+    }
+
+    // Rules only refer to sinks of earlier passes, so trying one type on every free tile at once
+    // tells where each of them would be valid.
+    std::vector<int> free, valid;
+    for (int coord{}; coord < static_cast<int>(allowedCoords.size()); ++coord) {
+      auto const &[x, y, z](allowedCoords[coord]);
+      if (sample.state(x, y, z) == Air)
+        free.emplace_back(coord);
+    }
+    double cooling{};
+    for (int sink : sinkOrder) {
+      if (cooling >= sample.value.heat || free.empty())
+        break;
+      for (int coord : free) {
+        auto const &[x, y, z](allowedCoords[coord]);
+        getSymCoords(x, y, z, changed);
+        for (auto const &[cx, cy, cz] : changed)
+          trial(cx, cy, cz) = sink;
+      }
+      evaluator.run(trial, trialValue);
+      trial = sample.state;
+      valid.clear();
+      for (int coord : free) {
+        auto const &[x, y, z](allowedCoords[coord]);
+        if (!trialValue.invalidTiles.test(trial.index(x, y, z)))
+          valid.emplace_back(coord);
+      }
+      std::shuffle(valid.begin(), valid.end(), rng);
+      for (int coord : valid) {
+        if (cooling >= sample.value.heat)
+          break;
+        auto const &[x, y, z](allowedCoords[coord]);
+        int nSym(getNSym(x, y, z));
+        if (sample.limit[sink] >= 0 && sample.limit[sink] < nSym)
+          continue;
+        sample.limit[sink] -= nSym;
+        setTileWithSym(sample, x, y, z, sink);
+        cooling += settings.coolingRates[sink] * nSym;
+      }
+      // Placed tiles are no longer air, so one pass drops them all from the free list.
+      free.erase(std::remove_if(free.begin(), free.end(), [&](int coord) {
+        auto const &[x, y, z](allowedCoords[coord]);
+        return sample.state(x, y, z) != Air;
+      }), free.end());
+      trial = sample.state;
+    }
+    evaluator.run(sample.state, sample.value);
+    removeInvalidTiles(sample, evaluator);
+  }
+
+  State fitLayout(const State &layout, int sizeX, int sizeY, int sizeZ, LayoutFit fit) {
+    State result(sizeX, sizeY, sizeZ, Air, Casing);
+    int size[3]{sizeX, sizeY, sizeZ}, offset[3];
+    for (int axis{}; axis < 3; ++axis)
+      offset[axis] = (size[axis] - layout.shape(axis)) / 2;
+    auto source([&](int axis, int i) {
+      int n(layout.shape(axis)), j(i - offset[axis]);
+      if (fit == LayoutFit::Tile)
+        return (j % n + n) % n;
+      return j >= 0 && j < n ? j : -1;
+    });
+    for (int x{}; x < sizeX; ++x)
+      for (int y{}; y < sizeY; ++y)
+        for (int z{}; z < sizeZ; ++z) {
+          int sx(source(0, x)), sy(source(1, y)), sz(source(2, z));
+          if (sx >= 0 && sy >= 0 && sz >= 0)
+            result(x, y, z) = layout(sx, sy, sz);
+        }
+    return result;
+  }
+
+  void Opt::restart() {
+    if (nextLayout < static_cast<int>(layouts.size())) {
+      mutator.copyLayout(parent, layouts[nextLayout++]);
+      evaluator.run(parent.state, parent.value);
+    } else if (initMode == InitMode::Greedy) {
+      // construct leaves the parent evaluated.
+      mutator.construct(parent, evaluator, rng);
+    } else {
+      mutator.randomize(parent, rng);
+      evaluator.run(parent.state, parent.value);
+    }
+    cache.store(parent.hash, parent.value);
+    syncTrial();
+  }
+
+  void Opt::syncTrial() {
+    trial.state = parent.state;
+    trial.limit = parent.limit;
+    trial.hash = parent.hash;
+    trial.tileCounts = parent.tileCounts;
+  }
+
+  Opt::Opt(const Settings &settings, bool useNet, int nChildren, int cacheEntries, std::uint32_t seed)
+    :settings(settings), evaluator(settings), cache(settings, cacheEntries), mutator(settings, cache),
     nEpisode(), nStage(), nIteration(), nConverge(),
     maxConverge(std::min(7 * 7 * 7, settings.sizeX * settings.sizeY * settings.sizeZ) * 16),
-    infeasibilityPenalty(), bestChanged(true), redrawNagle(), lossHistory(nLossHistory), lossChanged() {
-    for (int x(settings.symX ? settings.sizeX / 2 : 0); x < settings.sizeX; ++x)
-      for (int y(settings.symY ? settings.sizeY / 2 : 0); y < settings.sizeY; ++y)
-        for (int z(settings.symZ ? settings.sizeZ / 2 : 0); z < settings.sizeZ; ++z)
-          allowedCoords.emplace_back(x, y, z);
+    infeasibilityPenalty(), childMutations(nChildren), childValues(nChildren), childFitness(nChildren), rng(seed),
+    inferenceFailed(), bestChanged(true), redrawNagle(), lossHistory(nLossHistory), lossChanged(), nextLayout(), initMode(InitMode::Random) {
+    evaluator.setSymmetric(true);
 
+    parent.state = State(settings.sizeX, settings.sizeY, settings.sizeZ, Air, Casing);
     restart();
     if (useNet) {
       net = std::make_unique<Net>(*this);
@@ -49,14 +272,16 @@ namespace Fission {
     }
     parentFitness = currentFitness(parent);
 
-    best.state = xt::broadcast(Air,
-      {settings.sizeX, settings.sizeY, settings.sizeZ});
+    best.state = State(settings.sizeX, settings.sizeY, settings.sizeZ, Air, Casing);
+    best.limit = settings.limit;
+    best.hash = 0;
+    countTiles(best);
     evaluator.run(best.state, best.value);
   }
 
   Opt::~Opt() = default;
 
-  bool Opt::feasible(const Evaluation &x) const {
+  bool Opt::feasible(const Settings &settings, const Evaluation &x) {
     if (x.cooling <= 0.0)
       return false;
     if (settings.ensureHeatNeutral)
@@ -65,7 +290,7 @@ namespace Fission {
     return x.netHeat * 100 <= x.heatLimit * HeatPositiveMaxFraction;
   }
 
-  double Opt::rawFitness(const Evaluation &x) const {
+  double Opt::rawFitness(const Settings &settings, const Evaluation &x) {
     switch (settings.goal) {
       default:
         return x.avgPower;
@@ -83,7 +308,7 @@ namespace Fission {
     return rawFitness(x.value) - x.value.netHeat / settings.fuelBaseHeat * infeasibilityPenalty;
   }
 
-  int Opt::getNSym(const int x, const int y, const int z) const {
+  int Mutator::getNSym(const int x, const int y, const int z) const {
     int result(1);
     if (settings.symX && x != settings.sizeX - x - 1)
       result *= 2;
@@ -94,63 +319,156 @@ namespace Fission {
     return result;
   }
 
-  void Opt::setTileWithSym(Sample &sample, const int x, const int y, const int z, const int tile) const {
-    sample.state(x, y, z) = tile;
+  void Mutator::setTile(Sample &sample, const int i, const int tile) const {
+    sample.hash ^= cache.key(i, sample.state[i]) ^ cache.key(i, tile);
+    --sample.tileCounts[sample.state[i]];
+    ++sample.tileCounts[tile];
+    sample.state[i] = tile;
+  }
+
+  void Mutator::setTileWithSym(Sample &sample, const int x, const int y, const int z, const int tile) const {
+    auto set([&](int x, int y, int z) { setTile(sample, sample.state.index(x, y, z), tile); });
+    set(x, y, z);
     if (settings.symX) {
-      sample.state(settings.sizeX - x - 1, y, z) = tile;
+      set(settings.sizeX - x - 1, y, z);
       if (settings.symY) {
-        sample.state(x, settings.sizeY - y - 1, z) = tile;
-        sample.state(settings.sizeX - x - 1, settings.sizeY - y - 1, z) = tile;
+        set(x, settings.sizeY - y - 1, z);
+        set(settings.sizeX - x - 1, settings.sizeY - y - 1, z);
         if (settings.symZ) {
-          sample.state(x, y, settings.sizeZ - z - 1) = tile;
-          sample.state(settings.sizeX - x - 1, y, settings.sizeZ - z - 1) = tile;
-          sample.state(x, settings.sizeY - y - 1, settings.sizeZ - z - 1) = tile;
-          sample.state(settings.sizeX - x - 1, settings.sizeY - y - 1, settings.sizeZ - z - 1) = tile;
+          set(x, y, settings.sizeZ - z - 1);
+          set(settings.sizeX - x - 1, y, settings.sizeZ - z - 1);
+          set(x, settings.sizeY - y - 1, settings.sizeZ - z - 1);
+          set(settings.sizeX - x - 1, settings.sizeY - y - 1, settings.sizeZ - z - 1);
         }
       } else if (settings.symZ) {
-        sample.state(x, y, settings.sizeZ - z - 1) = tile;
-        sample.state(settings.sizeX - x - 1, y, settings.sizeZ - z - 1) = tile;
+        set(x, y, settings.sizeZ - z - 1);
+        set(settings.sizeX - x - 1, y, settings.sizeZ - z - 1);
       }
     } else if (settings.symY) {
-      sample.state(x, settings.sizeY - y - 1, z) = tile;
+      set(x, settings.sizeY - y - 1, z);
       if (settings.symZ) {
-        sample.state(x, y, settings.sizeZ - z - 1) = tile;
-        sample.state(x, settings.sizeY - y - 1, settings.sizeZ - z - 1) = tile;
+        set(x, y, settings.sizeZ - z - 1);
+        set(x, settings.sizeY - y - 1, settings.sizeZ - z - 1);
       }
     } else if (settings.symZ) {
-      sample.state(x, y, settings.sizeZ - z - 1) = tile;
+      set(x, y, settings.sizeZ - z - 1);
     }
   }
 
-  void Opt::mutateAndEvaluate(Sample &sample, const int x, const int y, const int z) {
-    int nSym = getNSym(x, y, z);
-    int oldTile = sample.state(x, y, z);
-    if (oldTile != Air) {
-      sample.limit[oldTile] += nSym;
+  void Mutator::getSymCoords(const int x, const int y, const int z, Coords &coords) const {
+    coords.clear();
+    for (int i{}; i < 8; ++i) {
+      if ((i & 1 && !settings.symX) || (i & 2 && !settings.symY) || (i & 4 && !settings.symZ))
+        continue;
+      coords.emplace_back(
+        i & 1 ? settings.sizeX - x - 1 : x,
+        i & 2 ? settings.sizeY - y - 1 : y,
+        i & 4 ? settings.sizeZ - z - 1 : z);
     }
+  }
+
+  void Mutator::propose(const Sample &sample, const int x, const int y, const int z, Mutation &mutation, std::mt19937 &rng) {
+    mutation.x = x;
+    mutation.y = y;
+    mutation.z = z;
+    mutation.nSym = getNSym(x, y, z);
+    mutation.oldTile = sample.state(x, y, z);
+    // The old tile's own instances count as available again.
     allowedTiles.clear();
     allowedTiles.emplace_back(Air);
-    for (int tile{}; tile < Air; ++tile)
-      if (sample.limit[tile] < 0 || sample.limit[tile] >= nSym)
+    for (int tile{}; tile < Air; ++tile) {
+      int limit(sample.limit[tile] + (tile == mutation.oldTile ? mutation.nSym : 0));
+      if (limit < 0 || limit >= mutation.nSym)
         allowedTiles.emplace_back(tile);
-    int newTile(allowedTiles[std::uniform_int_distribution<>(0, static_cast<int>(allowedTiles.size() - 1))(rng)]);
-    if (newTile != Air)
-      sample.limit[newTile] -= nSym;
-    setTileWithSym(sample, x, y, z, newTile);
-    evaluator.run(sample.state, sample.value);
+    }
+    mutation.newTile = allowedTiles[std::uniform_int_distribution<>(0, static_cast<int>(allowedTiles.size() - 1))(rng)];
+    getSymCoords(x, y, z, mutation.changedCoords);
+  }
+
+  void Mutator::apply(Sample &sample, const Mutation &mutation) const {
+    if (mutation.oldTile != Air)
+      sample.limit[mutation.oldTile] += mutation.nSym;
+    if (mutation.newTile != Air)
+      sample.limit[mutation.newTile] -= mutation.nSym;
+    setTileWithSym(sample, mutation.x, mutation.y, mutation.z, mutation.newTile);
+  }
+
+  void Mutator::undo(Sample &sample, const Mutation &mutation) const {
+    if (mutation.newTile != Air)
+      sample.limit[mutation.newTile] += mutation.nSym;
+    if (mutation.oldTile != Air)
+      sample.limit[mutation.oldTile] -= mutation.nSym;
+    setTileWithSym(sample, mutation.x, mutation.y, mutation.z, mutation.oldTile);
+  }
+
+  void Mutator::mutate(Sample &sample, const int x, const int y, const int z, Mutation &mutation, std::mt19937 &rng) {
+    propose(sample, x, y, z, mutation, rng);
+    apply(sample, mutation);
+  }
+
+  void Mutator::removeInvalidTiles(Sample &sample, Evaluator &evaluator) {
+    evaluator.removeInvalidTiles(sample.state, sample.value, removedTiles);
+    for (auto const &[i, tile] : removedTiles) {
+      sample.hash ^= cache.key(i, tile) ^ cache.key(i, Air);
+      --sample.tileCounts[tile];
+      ++sample.tileCounts[Air];
+      if (sample.limit[tile] >= 0)
+        ++sample.limit[tile];
+    }
+  }
+
+  void Opt::restartFirstEpisode() {
+    restart();
+    if (net) {
+      net->newTrajectory();
+      net->appendTrajectory(parent);
+    }
+    parentFitness = currentFitness(parent);
+  }
+
+  void Opt::setInitialLayouts(std::vector<State> layouts) {
+    this->layouts = std::move(layouts);
+    nextLayout = 0;
+    restartFirstEpisode();
+  }
+
+#ifndef __EMSCRIPTEN__
+  void Opt::setAsyncTraining(bool enabled) {
+    if (!net)
+      throw std::runtime_error("Background training needs a net");
+    net->setAsync(enabled);
+  }
+#endif
+
+  void Opt::setInitMode(InitMode mode) {
+    if (mode == initMode)
+      return;
+    initMode = mode;
+    restartFirstEpisode();
+  }
+
+  void Opt::pushLoss(double loss) {
+    for (int i{}; i < nLossHistory - 1; ++i)
+      lossHistory[i] = lossHistory[i + 1];
+    lossHistory[nLossHistory - 1] = loss;
+    lossChanged = true;
   }
 
   void Opt::step() {
+    if (net && net->acquireSnapshot()) {
+      for (double loss : net->getSnapshotLosses())
+        pushLoss(loss);
+      if (nStage == StageInfer)
+        parentFitness = net->infer(parent);
+    }
     if (nStage == StageTrain) {
-      if (!nIteration) {
+      // A checkpoint taken without a background trainer may have stopped in the middle of training.
+      if (!nIteration || net->isAsync()) {
         nStage = StageInfer;
         parentFitness = net->infer(parent);
         inferenceFailed = true;
       } else {
-        for (int i{}; i < nLossHistory - 1; ++i)
-          lossHistory[i] = lossHistory[i + 1];
-        lossHistory[nLossHistory - 1] = net->train();
-        lossChanged = true;
+        pushLoss(net->train());
         --nIteration;
         return;
       }
@@ -168,7 +486,12 @@ namespace Fission {
         net->appendTrajectory(parent);
       } else if (feasible(parent.value) || infeasibilityPenalty > 1e8) {
         infeasibilityPenalty = 0.0;
-        if (net) {
+        if (net && net->isAsync()) {
+          // The background trainer learns from the trajectory while the search goes on.
+          net->finishTrajectory(feasible(parent.value) ? rawFitness(parent.value) : 0.0);
+          nStage = StageInfer;
+          inferenceFailed = true;
+        } else if (net) {
           nStage = StageTrain;
           net->finishTrajectory(feasible(parent.value) ? rawFitness(parent.value) : 0.0);
           nIteration = (net->getTrajectoryLength() * nEpoch + nMiniBatch - 1) / nMiniBatch;
@@ -195,24 +518,38 @@ namespace Fission {
       xDist(0, settings.sizeX - 1),
       yDist(0, settings.sizeY - 1),
       zDist(0, settings.sizeZ - 1);
-    int bestChild = 0;
-    double bestFitness = 0.0;
-    for (int i{}; i < children.size(); ++i) {
-      auto &child(children[i]);
-      child.state = parent.state;
-      std::copy(parent.limit.begin(), parent.limit.end(), child.limit.begin());
-      mutateAndEvaluate(child, xDist(rng), yDist(rng), zDist(rng));
-      double fitness(currentFitness(child));
-      if (!i || fitness > bestFitness) {
-        bestChild = i;
-        bestFitness = fitness;
+    // Each child is applied to trial, scored and undone again; only the winner reaches parent.
+    for (int i{}; i < static_cast<int>(childMutations.size()); ++i) {
+      auto &mutation(childMutations[i]);
+      auto &value(childValues[i]);
+      mutator.propose(trial, xDist(rng), yDist(rng), zDist(rng), mutation, rng);
+      mutator.apply(trial, mutation);
+      if (cache.lookup(trial.hash, value)) {
+        value.compute(settings);
+      } else {
+        evaluator.applyDelta(parent.state, parent.value, trial.state, mutation.changedCoords, value);
+        cache.store(trial.hash, value);
       }
-      if (feasible(child.value) && rawFitness(child.value) > rawFitness(best.value)) {
+      std::swap(trial.value, value);
+      if (nStage == StageInfer)
+        net->setInferRow(i, trial);
+      else
+        childFitness[i] = currentFitness(trial);
+      if (feasible(trial.value) && rawFitness(trial.value) > rawFitness(best.value)) {
         bestChangedLocal = true;
-        best = child;
+        best = trial;
       }
+      std::swap(trial.value, value);
+      mutator.undo(trial, mutation);
     }
-    auto &child(children[bestChild]);
+    // The net scores all children together, in one pass through its layers.
+    if (nStage == StageInfer)
+      net->inferBatch(static_cast<int>(childFitness.size()), childFitness.data());
+    int bestChild = 0;
+    for (int i(1); i < static_cast<int>(childFitness.size()); ++i)
+      if (childFitness[i] > childFitness[bestChild])
+        bestChild = i;
+    double bestFitness(childFitness[bestChild]);
     if (bestFitness >= parentFitness) {
       if (bestFitness > parentFitness) {
         parentFitness = bestFitness;
@@ -220,30 +557,41 @@ namespace Fission {
         if (nStage == StageInfer)
           inferenceFailed = false;
       }
-      std::swap(parent, child);
+      auto &mutation(childMutations[bestChild]);
+      mutator.apply(parent, mutation);
+      mutator.apply(trial, mutation);
+      std::swap(parent.value, childValues[bestChild]);
       if (net && nStage != StageInfer)
         net->appendTrajectory(parent);
     }
     ++nConverge;
     ++nIteration;
     if (bestChangedLocal) {
-      bool removedInvalidTiles = false;
-      do {
-        removedInvalidTiles = false;
-        for (auto &[x, y, z] : best.value.invalidTiles)
-          if (best.state(x, y, z) != Air) {
-            best.state(x, y, z) = Air;
-            removedInvalidTiles = true;
-          }
-        if (removedInvalidTiles)
-          evaluator.run(best.state, best.value);
-      } while (removedInvalidTiles);
-      if (!best.value.invalidTiles.empty())
-        evaluator.run(best.state, best.value);
+      mutator.removeInvalidTiles(best, evaluator);
       bestChanged = true;
     }
   }
 
+  bool Opt::immigrate(const Sample &sample) {
+    // Training and inference stages follow their own trajectory; leave them alone.
+    if (nStage < 0)
+      return false;
+    double fitness(currentFitness(sample));
+    if (fitness <= parentFitness)
+      return false;
+    parent = sample;
+    syncTrial();
+    parentFitness = fitness;
+    nConverge = 0;
+    if (net)
+      net->appendTrajectory(parent);
+    if (feasible(parent.value) && rawFitness(parent.value) > rawFitness(best.value)) {
+      best = parent;
+      bestChanged = true;
+    }
+    return true;
+  }
+
   void Opt::stepInteractive() {
     const int dim(settings.sizeX * settings.sizeY * settings.sizeZ);
     const int n(std::min(interactiveMin, (interactiveScale + dim - 1) / dim));
@@ -269,4 +617,98 @@ namespace Fission {
       lossChanged = false;
     return result;
   }
+
+  void countTiles(Sample &sample) {
+    const State &state(sample.state);
+    sample.tileCounts.fill(0);
+    for (int x{}; x < state.shape(0); ++x)
+      for (int y{}; y < state.shape(1); ++y)
+        for (int z{}; z < state.shape(2); ++z)
+          ++sample.tileCounts[state(x, y, z)];
+  }
+
+  void writeSample(CheckpointWriter &out, const Sample &sample) {
+    out.array(sample.limit.data(), sample.limit.size());
+    out.array(sample.state.data(), sample.state.size());
+  }
+
+  void readSample(CheckpointReader &in, Sample &sample) {
+    in.array(sample.limit.data(), sample.limit.size());
+    in.array(sample.state.data(), sample.state.size());
+    countTiles(sample);
+  }
+
+  void Mutator::save(CheckpointWriter &out) const {
+    out.arrayHeader(allowedCoords.size() * 3);
+    for (auto &[x, y, z] : allowedCoords) {
+      out.value(x);
+      out.value(y);
+      out.value(z);
+    }
+  }
+
+  void Mutator::load(CheckpointReader &in) {
+    in.expect(in.arrayHeader() == allowedCoords.size() * 3, "core size");
+    for (auto &[x, y, z] : allowedCoords) {
+      x = in.value<int>();
+      y = in.value<int>();
+      z = in.value<int>();
+    }
+  }
+
+  void Opt::save(CheckpointWriter &out) const {
+    out.value(nEpisode);
+    out.value(nStage);
+    out.value(nIteration);
+    out.value(nConverge);
+    out.value(infeasibilityPenalty);
+    out.value(parentFitness);
+    out.value(inferenceFailed);
+    out.value(nextLayout);
+    out.random(rng);
+    mutator.save(out);
+    writeSample(out, parent);
+    writeSample(out, best);
+    out.array(lossHistory.data(), lossHistory.size());
+    out.value(static_cast<bool>(net));
+    if (net)
+      net->save(out);
+  }
+
+  void Opt::load(CheckpointReader &in) {
+    nEpisode = in.value<int>();
+    nStage = in.value<int>();
+    nIteration = in.value<int>();
+    nConverge = in.value<int>();
+    infeasibilityPenalty = in.value<double>();
+    parentFitness = in.value<double>();
+    inferenceFailed = in.value<bool>();
+    nextLayout = in.value<int>();
+    in.random(rng);
+    mutator.load(in);
+    readSample(in, parent);
+    readSample(in, best);
+    in.array(lossHistory.data(), lossHistory.size());
+    in.expect(in.value<bool>() == static_cast<bool>(net), "net setting");
+    if (net)
+      net->load(in);
+    parent.hash = cache.hashOf(parent.state);
+    evaluator.run(parent.state, parent.value);
+    best.hash = cache.hashOf(best.state);
+    evaluator.run(best.state, best.value);
+    syncTrial();
+    bestChanged = true;
+    lossChanged = true;
+  }
+
+  void Opt::saveCheckpoint(const std::string &path) const {
+    CheckpointWriter out(path, CheckpointKind::Opt, settings);
+    save(out);
+    out.commit();
+  }
+
+  void Opt::loadCheckpoint(const std::string &path) {
+    CheckpointReader in(path, CheckpointKind::Opt, settings);
+    load(in);
+  }
 }
@@ -2,12 +2,16 @@
 #define _OPT_FISSION_H_
 #include <random>
 #include <memory>
-#include "Fission.h"
+#include "FissionCache.h"
 
 namespace Fission {
   struct Sample {
     std::array<int, TileCount> limit;
-    xt::xtensor<int, 3> state;
+    State state;
+    // Zobrist hash of state, kept up to date by Opt::setTile.
+    std::uint64_t hash;
+    // Number of interior tiles of each kind, air included, kept up to date alongside hash.
+    std::array<int, TileCount + 1> tileCounts;
     Evaluation value;
   };
 
@@ -17,21 +21,103 @@ namespace Fission {
   };
 
   constexpr int interactiveMin(1024), interactiveScale(327680), interactiveNet(16), nLossHistory(256);
+  constexpr int defaultCacheEntries(4096);
 
   class Net;
+  class CheckpointWriter;
+  class CheckpointReader;
+
+  enum class LayoutFit : int {
+    // Repeat the layout periodically along axes where the core is larger.
+    Tile,
+    // Surround the layout with air along axes where the core is larger.
+    Pad
+  };
+
+  enum class InitMode : int {
+    // Uniformly random legal tiles.
+    Random,
+    // Mutator::construct.
+    Greedy
+  };
+
+  // Layout resized to a core of sizeX x sizeY x sizeZ, centred; axes where it is larger are cropped.
+  State fitLayout(const State &layout, int sizeX, int sizeY, int sizeZ, LayoutFit fit);
+
+  // Recounts tileCounts of a sample from its state.
+  void countTiles(Sample &sample);
+
+  // Checkpoint form of a sample: limits and tiles; the hash and evaluation are recomputed on load,
+  // the tile counts by readSample.
+  void writeSample(CheckpointWriter &out, const Sample &sample);
+  void readSample(CheckpointReader &in, Sample &sample);
+
+  // Tile changes on samples that keep mirror images in step, respect tile limits and
+  // maintain the Zobrist hash. Shared by the search engines.
+  class Mutator {
+  public:
+    // A change of one tile and its mirror images, kept so that it can be applied and undone.
+    struct Mutation {
+      int x, y, z, oldTile, newTile, nSym;
+      Coords changedCoords;
+    };
+  private:
+    const Settings &settings;
+    const TranspositionTable &cache;
+    // Tiles of the fundamental domain of the symmetry axes.
+    Coords allowedCoords;
+    std::vector<int> allowedTiles;
+    // Heat sinks within the limits that cool, by pass of their rules and then highest cooling rate first.
+    std::vector<int> sinkOrder;
+    std::vector<std::pair<int, int>> removedTiles;
+    // Resets sample to an empty core with the limits of settings.
+    void clear(Sample &sample) const;
+    void construct(Sample &sample, Evaluator &evaluator, std::mt19937 &rng, double sinkShare);
+  public:
+    Mutator(const Settings &settings, const TranspositionTable &cache);
+    int getNSym(int x, int y, int z) const;
+    void setTile(Sample &sample, int i, int tile) const;
+    void setTileWithSym(Sample &sample, int x, int y, int z, int tile) const;
+    void getSymCoords(int x, int y, int z, Coords &coords) const;
+    // Fills sample with random tiles within the limits; the caller evaluates it.
+    void randomize(Sample &sample, std::mt19937 &rng);
+    // Fills sample with the tiles of a core-sized layout on the fundamental domain, mirrored, leaving
+    // air where a tile would exceed its limit; the caller evaluates it. Returns the tiles left out.
+    int copyLayout(Sample &sample, const State &layout) const;
+    // Fills sample with a design built up tile by tile and leaves it evaluated. Cells and moderators
+    // go wherever a few sampled tiles most raise the fitness expected once the rest is cooled; then
+    // heat sinks go, pass by pass of their rules, where they are valid until the heat is covered.
+    // When the sinks fall short, it starts over counting on fewer of the free tiles becoming sinks.
+    void construct(Sample &sample, Evaluator &evaluator, std::mt19937 &rng);
+    // Draws a new tile for (x, y, z) within the limits of sample, leaving sample unchanged.
+    void propose(const Sample &sample, int x, int y, int z, Mutation &mutation, std::mt19937 &rng);
+    void apply(Sample &sample, const Mutation &mutation) const;
+    void undo(Sample &sample, const Mutation &mutation) const;
+    void mutate(Sample &sample, int x, int y, int z, Mutation &mutation, std::mt19937 &rng);
+    // Clears the tiles an evaluation marked invalid until none are left and returns them to the limits;
+    // see Evaluator::removeInvalidTiles.
+    void removeInvalidTiles(Sample &sample, Evaluator &evaluator);
+    // Order of the domain tiles, which randomize shuffles in place.
+    void save(CheckpointWriter &out) const;
+    void load(CheckpointReader &in);
+  };
 
   class Opt {
     friend Net;
     const Settings &settings;
     Evaluator evaluator;
-    Coords allowedCoords;
-    std::vector<int> allowedTiles;
+    TranspositionTable cache;
+    Mutator mutator;
     int nEpisode, nStage, nIteration;
     int nConverge, maxConverge;
     double infeasibilityPenalty;
     double parentFitness;
     Sample parent, best;
-    std::array<Sample, 4> children;
+    // Copy of parent that children are tried on in place; its value is scratch.
+    Sample trial;
+    std::vector<Mutator::Mutation> childMutations;
+    std::vector<Evaluation> childValues;
+    std::vector<double> childFitness;
     std::mt19937 rng;
     std::unique_ptr<Net> net;
     bool inferenceFailed;
@@ -39,22 +125,52 @@ namespace Fission {
     int redrawNagle;
     std::vector<double> lossHistory;
     bool lossChanged;
+    // Starting points of the next restarts, before they go back to random tiles.
+    std::vector<State> layouts;
+    int nextLayout;
+    InitMode initMode;
     void restart();
-    bool feasible(const Evaluation &x) const;
-    double rawFitness(const Evaluation &x) const;
+    void restartFirstEpisode();
+    void syncTrial();
+    bool feasible(const Evaluation &x) const { return feasible(settings, x); }
+    double rawFitness(const Evaluation &x) const { return rawFitness(settings, x); }
     double currentFitness(const Sample &x) const;
-    int getNSym(int x, int y, int z) const;
-    void setTileWithSym(Sample &sample, int x, int y, int z, int tile) const;
-    void mutateAndEvaluate(Sample &sample, int x, int y, int z);
+    void pushLoss(double loss);
   public:
-    Opt(const Settings &settings, bool useNet);
+    static bool feasible(const Settings &settings, const Evaluation &x);
+    // Value of an evaluation under the goal of settings, ignoring feasibility.
+    static double rawFitness(const Settings &settings, const Evaluation &x);
+    Opt(const Settings &settings, bool useNet, int nChildren = 4, int cacheEntries = defaultCacheEntries,
+      std::uint32_t seed = std::mt19937::default_seed);
     ~Opt();
+    // Restarts from the first layout and takes the others as the following restarts; call before stepping.
+    void setInitialLayouts(std::vector<State> layouts);
+    // How restarts without a layout fill the core; restarts now if it changes, so call before stepping.
+    void setInitMode(InitMode mode);
+#ifndef __EMSCRIPTEN__
+    // Trains the net on a background thread while the search goes on with its latest weights,
+    // instead of pausing the search to train after each trajectory; call before stepping.
+    void setAsyncTraining(bool enabled);
+#endif
     void step();
     void stepInteractive();
+    // Continues the search from a sample found elsewhere if it beats the current parent.
+    bool immigrate(const Sample &sample);
+    // Search state including the random stream and the net; the cache is not saved.
+    void save(CheckpointWriter &out) const;
+    // Restores a state saved by an Opt with the same settings and net setting.
+    void load(CheckpointReader &in);
+    void saveCheckpoint(const std::string &path) const;
+    void loadCheckpoint(const std::string &path);
+    void setDifferentialCheck(bool enabled) { evaluator.setDifferentialCheck(enabled); }
+    void setBackend(Backend backend) { evaluator.setBackend(backend); }
+    std::uint64_t getCacheHits() const { return cache.getHits(); }
+    std::uint64_t getCacheMisses() const { return cache.getMisses(); }
     bool needsRedrawBest();
     bool needsReplotLoss();
     const std::vector<double> &getLossHistory() const { return lossHistory; }
     const Sample &getBest() const { return best; }
+    double getBestFitness() const { return rawFitness(best.value); }
     int getNEpisode() const { return nEpisode; }
     int getNStage() const { return nStage; }
     int getNIteration() const { return nIteration; }
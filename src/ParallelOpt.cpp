@@ -0,0 +1,149 @@
+#include "ParallelOpt.h"
+#include <utility>
+#include "Checkpoint.h"
+
+namespace Fission {
+  ParallelOpt::ParallelOpt(const Settings &settings, int nIslands, bool useNet, int nChildren, int cacheEntries, int migrationInterval)
+    :settings(settings), migrationInterval(migrationInterval), bestIsland(), pool(nIslands) {
+    for (int i{}; i < nIslands; ++i) {
+      std::uint32_t seed(std::mt19937::default_seed);
+      if (i) {
+        std::seed_seq sequence{static_cast<std::uint32_t>(i)};
+        sequence.generate(&seed, &seed + 1);
+      }
+      auto island(std::make_unique<Island>());
+      island->opt = std::make_unique<Opt>(settings, useNet, nChildren, cacheEntries, seed);
+      island->hasEmigrant = false;
+      island->nSteps = 0;
+      islands.emplace_back(std::move(island));
+    }
+    best = islands.front()->opt->getBest();
+    bestFitness.store(islands.front()->opt->getBestFitness(), std::memory_order_relaxed);
+  }
+
+  void ParallelOpt::runIsland(int island, int nSteps) {
+    auto &self(*islands[island]);
+    for (int i{}; i < nSteps; ++i) {
+      self.opt->step();
+      // Every step: an island's own best can get worse when its invalid tiles are stripped.
+      publishBest(island);
+      if (++self.nSteps % migrationInterval == 0 && islands.size() > 1)
+        migrate(island);
+    }
+  }
+
+  void ParallelOpt::migrate(int island) {
+    auto &self(*islands[island]);
+    {
+      std::lock_guard<std::mutex> lock(self.mutex);
+      self.emigrant = self.opt->getBest();
+      self.hasEmigrant = true;
+    }
+    auto &neighbour(*islands[(island + islands.size() - 1) % islands.size()]);
+    {
+      std::lock_guard<std::mutex> lock(neighbour.mutex);
+      if (!neighbour.hasEmigrant)
+        return;
+      self.incoming = neighbour.emigrant;
+    }
+    self.opt->immigrate(self.incoming);
+  }
+
+  void ParallelOpt::publishBest(int island) {
+    // Checked without the lock first: most calls find nothing new.
+    const Opt &opt(*islands[island]->opt);
+    double fitness(opt.getBestFitness());
+    if (fitness <= bestFitness.load(std::memory_order_relaxed))
+      return;
+    std::lock_guard<std::mutex> lock(bestMutex);
+    if (fitness <= bestFitness.load(std::memory_order_relaxed))
+      return;
+    best = opt.getBest();
+    bestIsland = island;
+    bestFitness.store(fitness, std::memory_order_relaxed);
+  }
+
+  void ParallelOpt::step(int nSteps) {
+    pool.run(getNIslands(), [&](int island) { runIsland(island, nSteps); });
+  }
+
+  void ParallelOpt::setDifferentialCheck(bool enabled) {
+    for (auto &island : islands)
+      island->opt->setDifferentialCheck(enabled);
+  }
+
+  void ParallelOpt::setBackend(Backend backend) {
+    for (auto &island : islands)
+      island->opt->setBackend(backend);
+  }
+
+  void ParallelOpt::setInitialLayouts(const std::vector<State> &layouts) {
+    if (layouts.empty())
+      return;
+    for (int i{}; i < getNIslands(); ++i) {
+      std::vector<State> rotated(layouts.size());
+      for (std::size_t j{}; j < layouts.size(); ++j)
+        rotated[j] = layouts[(i + j) % layouts.size()];
+      islands[i]->opt->setInitialLayouts(std::move(rotated));
+    }
+  }
+
+  void ParallelOpt::setInitMode(InitMode mode) {
+    for (auto &island : islands)
+      island->opt->setInitMode(mode);
+  }
+
+  void ParallelOpt::setAsyncTraining(bool enabled) {
+    for (auto &island : islands)
+      island->opt->setAsyncTraining(enabled);
+  }
+
+  std::uint64_t ParallelOpt::getCacheHits() const {
+    std::uint64_t result{};
+    for (auto &island : islands)
+      result += island->opt->getCacheHits();
+    return result;
+  }
+
+  std::uint64_t ParallelOpt::getCacheMisses() const {
+    std::uint64_t result{};
+    for (auto &island : islands)
+      result += island->opt->getCacheMisses();
+    return result;
+  }
+
+  void ParallelOpt::saveCheckpoint(const std::string &path) const {
+    CheckpointWriter out(path, CheckpointKind::Islands, settings);
+    out.value(getNIslands());
+    for (auto &island : islands) {
+      out.value(island->nSteps);
+      island->opt->save(out);
+    }
+    writeSample(out, best);
+    out.value(bestIsland);
+    out.commit();
+  }
+
+  void ParallelOpt::loadCheckpoint(const std::string &path) {
+    CheckpointReader in(path, CheckpointKind::Islands, settings);
+    in.expect(in.value<int>() == getNIslands(), "island count");
+    for (auto &island : islands) {
+      island->nSteps = in.value<int>();
+      island->opt->load(in);
+      island->hasEmigrant = false;
+    }
+    readSample(in, best);
+    bestIsland = in.value<int>();
+    in.expect(bestIsland >= 0 && bestIsland < getNIslands(), "best island");
+    best.hash = TranspositionTable(settings, 0).hashOf(best.state);
+    Evaluator(settings).run(best.state, best.value);
+    bestFitness.store(Opt::rawFitness(settings, best.value), std::memory_order_relaxed);
+  }
+
+  void ParallelOpt::printProgress(std::ostream &out) const {
+    const Opt &island(getIsland(bestIsland));
+    out << " episode=" << island.getNEpisode()
+        << " stage=" << island.getNStage()
+        << " iter=" << island.getNIteration();
+  }
+}
@@ -0,0 +1,66 @@
+#ifndef _PARALLEL_OPT_H_
+#define _PARALLEL_OPT_H_
+#include <atomic>
+#include <mutex>
+#include "Engine.h"
+#include "WorkerPool.h"
+
+namespace Fission {
+  constexpr int defaultMigrationInterval(2048);
+
+  // Island model: independent Opt instances on worker threads, each with its own evaluator,
+  // cache, random stream and net. Every migrationInterval steps an island publishes its best
+  // sample and adopts the one last published by its neighbour on a ring, if that is better.
+  // With more than one island, migration timing makes runs nondeterministic.
+  class ParallelOpt : public Engine {
+    struct Island {
+      std::unique_ptr<Opt> opt;
+      std::mutex mutex;
+      Sample emigrant;
+      // Scratch copy of the neighbour's emigrant, reused so that migration does not allocate.
+      Sample incoming;
+      bool hasEmigrant;
+      int nSteps;
+    };
+
+    const Settings &settings;
+    std::vector<std::unique_ptr<Island>> islands;
+    int migrationInterval;
+    std::mutex bestMutex;
+    std::atomic<double> bestFitness;
+    Sample best;
+    int bestIsland;
+    WorkerPool pool;
+
+    void runIsland(int island, int nSteps);
+    void migrate(int island);
+    void publishBest(int island);
+  public:
+    // Island 0 uses the default seed, so a single island reproduces Opt exactly.
+    ParallelOpt(const Settings &settings, int nIslands, bool useNet, int nChildren = 4,
+      int cacheEntries = defaultCacheEntries, int migrationInterval = defaultMigrationInterval);
+    // Advances every island by nSteps; returns once all have finished.
+    void step(int nSteps) override;
+    void setDifferentialCheck(bool enabled) override;
+    void setBackend(Backend backend) override;
+    // Island i starts from layout i and takes the rest, in turn, as its restarts.
+    void setInitialLayouts(const std::vector<State> &layouts) override;
+    void setInitMode(InitMode mode) override;
+    // Each island trains its net on a thread of its own; see Opt::setAsyncTraining.
+    void setAsyncTraining(bool enabled);
+    int getNIslands() const { return static_cast<int>(islands.size()); }
+    const Opt &getIsland(int island) const { return *islands[island]->opt; }
+    // Best sample over all islands as of the last step.
+    const Sample &getBest() const override { return best; }
+    double getBestFitness() const override { return bestFitness.load(std::memory_order_relaxed); }
+    int getBestIsland() const { return bestIsland; }
+    std::uint64_t getCacheHits() const override;
+    std::uint64_t getCacheMisses() const override;
+    // Search progress of the island holding the best sample.
+    void printProgress(std::ostream &out) const override;
+    void saveCheckpoint(const std::string &path) const override;
+    void loadCheckpoint(const std::string &path) override;
+  };
+}
+
+#endif
@@ -0,0 +1,253 @@
+#include "TemperingOpt.h"
+#include <algorithm>
+#include <cmath>
+#include "Checkpoint.h"
+
+namespace Fission {
+  namespace {
+    constexpr int Air = static_cast<int>(Tile::Air);
+    constexpr int Casing = static_cast<int>(Tile::Casing);
+  }
+
+  TemperingOpt::Replica::Replica(const Settings &settings, const TranspositionTable &cache, std::uint32_t seed)
+    :evaluator(settings), mutator(settings, cache), rng(seed),
+    temperature(), bestFitness(), newBest(), nProposed(), nAccepted() {
+    evaluator.setSymmetric(true);
+    current.state = State(settings.sizeX, settings.sizeY, settings.sizeZ, Air, Casing);
+  }
+
+  TemperingOpt::TemperingOpt(const Settings &settings, int nReplicas, int nThreads, int cacheEntries, int exchangeInterval)
+    :settings(settings), cache(settings, cacheEntries), exchangeInterval(exchangeInterval),
+    nSinceExchange(), parity(), nSwapsProposed(), nSwapsAccepted(), pool(nThreads) {
+    best.state = State(settings.sizeX, settings.sizeY, settings.sizeZ, Air, Casing);
+    best.hash = 0;
+    countTiles(best);
+    best.limit = settings.limit;
+    for (int i{}; i < nReplicas; ++i) {
+      std::seed_seq sequence{static_cast<std::uint32_t>(i)};
+      std::uint32_t seed;
+      sequence.generate(&seed, &seed + 1);
+      auto replica(std::make_unique<Replica>(settings, cache, seed));
+      if (!i)
+        replica->evaluator.run(best.state, best.value);
+      replica->mutator.randomize(replica->current, replica->rng);
+      replica->evaluator.run(replica->current.state, replica->current.value);
+      cache.store(replica->current.hash, replica->current.value);
+      replica->trial = replica->current;
+      replica->best = best;
+      replicas.emplace_back(std::move(replica));
+    }
+    bestFitness = Opt::rawFitness(settings, best.value);
+    for (auto &replica : replicas)
+      replica->bestFitness = bestFitness;
+    updateTemperatures(bestFitness);
+  }
+
+  double TemperingOpt::penalizedFitness(const Evaluation &x) const {
+    double fitness(Opt::rawFitness(settings, x));
+    if (Opt::feasible(settings, x))
+      return fitness;
+    return fitness - x.netHeat / settings.fuelBaseHeat * scale;
+  }
+
+  void TemperingOpt::updateTemperatures(double reference) {
+    // Temperatures follow the best fitness, so acceptance means the same at any power level.
+    scale = std::max(std::abs(reference), settings.goal == Goal::Power ? settings.fuelBasePower : 1.0);
+    int n(static_cast<int>(replicas.size()));
+    for (int i{}; i < n; ++i) {
+      double t(n > 1 ? static_cast<double>(i) / (n - 1) : 0.0);
+      replicas[i]->temperature = scale * temperingMin * std::pow(temperingMax / temperingMin, t);
+    }
+  }
+
+  void TemperingOpt::runReplica(int index, int nSteps) {
+    auto &replica(*replicas[index]);
+    std::uniform_int_distribution<>
+      xDist(0, settings.sizeX - 1),
+      yDist(0, settings.sizeY - 1),
+      zDist(0, settings.sizeZ - 1);
+    std::uniform_real_distribution<> uniform;
+    double currentFitness(penalizedFitness(replica.current.value));
+    // Each proposal is applied to trial, scored and undone again unless accepted; as in Opt::step.
+    auto &trial(replica.trial);
+    auto &mutation(replica.mutation);
+    for (int i{}; i < nSteps; ++i) {
+      int x(xDist(replica.rng)), y(yDist(replica.rng)), z(zDist(replica.rng));
+      replica.mutator.propose(trial, x, y, z, mutation, replica.rng);
+      replica.mutator.apply(trial, mutation);
+      if (cache.lookup(trial.hash, trial.value)) {
+        trial.value.compute(settings);
+      } else {
+        replica.evaluator.applyDelta(replica.current.state, replica.current.value, trial.state, mutation.changedCoords, trial.value);
+        cache.store(trial.hash, trial.value);
+      }
+      ++replica.nProposed;
+      double fitness(penalizedFitness(trial.value));
+      if (fitness < currentFitness && uniform(replica.rng) >= std::exp((fitness - currentFitness) / replica.temperature)) {
+        replica.mutator.undo(trial, mutation);
+        continue;
+      }
+      ++replica.nAccepted;
+      currentFitness = fitness;
+      replica.mutator.apply(replica.current, mutation);
+      std::swap(replica.current.value, trial.value);
+      if (Opt::feasible(settings, replica.current.value) && Opt::rawFitness(settings, replica.current.value) > replica.bestFitness) {
+        replica.best = replica.current;
+        replica.bestFitness = Opt::rawFitness(settings, replica.current.value);
+        replica.newBest = true;
+      }
+    }
+  }
+
+  void TemperingOpt::exchange() {
+    // Even and odd neighbour pairs take turns, so every pair is offered a swap every other round.
+    double reference(bestFitness);
+    for (auto &replica : replicas)
+      reference = std::max(reference, replica->bestFitness);
+    updateTemperatures(reference);
+    std::uniform_real_distribution<> uniform;
+    for (int i(parity); i + 1 < static_cast<int>(replicas.size()); i += 2) {
+      auto &cold(*replicas[i]), &hot(*replicas[i + 1]);
+      double delta((penalizedFitness(hot.current.value) - penalizedFitness(cold.current.value))
+        * (1 / cold.temperature - 1 / hot.temperature));
+      ++nSwapsProposed;
+      if (delta >= 0 || uniform(rng) < std::exp(delta)) {
+        ++nSwapsAccepted;
+        std::swap(cold.current, hot.current);
+        std::swap(cold.trial, hot.trial);
+      }
+    }
+    parity ^= 1;
+  }
+
+  void TemperingOpt::step(int nSteps) {
+    while (nSteps) {
+      int chunk(std::min(nSteps, exchangeInterval - nSinceExchange));
+      pool.run(static_cast<int>(replicas.size()), [&](int replica) { runReplica(replica, chunk); });
+      nSteps -= chunk;
+      nSinceExchange += chunk;
+      if (nSinceExchange == exchangeInterval) {
+        nSinceExchange = 0;
+        exchange();
+      }
+    }
+    // Stripping invalid tiles can lower a design's fitness, so replica bests are compared after it.
+    // Replicas keep comparing new designs against the fitness before stripping, so each best is
+    // stripped once, and not at all when even that cannot beat the overall best.
+    for (auto &replica : replicas) {
+      if (!replica->newBest)
+        continue;
+      replica->newBest = false;
+      if (replica->bestFitness <= bestFitness)
+        continue;
+      replica->mutator.removeInvalidTiles(replica->best, replica->evaluator);
+      double fitness(Opt::rawFitness(settings, replica->best.value));
+      if (fitness > bestFitness) {
+        best = replica->best;
+        bestFitness = fitness;
+      }
+    }
+  }
+
+  void TemperingOpt::setDifferentialCheck(bool enabled) {
+    for (auto &replica : replicas)
+      replica->evaluator.setDifferentialCheck(enabled);
+  }
+
+  void TemperingOpt::setBackend(Backend backend) {
+    for (auto &replica : replicas)
+      replica->evaluator.setBackend(backend);
+  }
+
+  void TemperingOpt::restartReplica(Replica &replica) {
+    replica.evaluator.run(replica.current.state, replica.current.value);
+    cache.store(replica.current.hash, replica.current.value);
+    replica.trial = replica.current;
+    if (Opt::feasible(settings, replica.current.value) && Opt::rawFitness(settings, replica.current.value) > replica.bestFitness) {
+      replica.best = replica.current;
+      replica.bestFitness = Opt::rawFitness(settings, replica.current.value);
+      replica.newBest = true;
+    }
+  }
+
+  void TemperingOpt::setInitialLayouts(const std::vector<State> &layouts) {
+    if (layouts.empty())
+      return;
+    for (std::size_t i{}; i < replicas.size(); ++i) {
+      replicas[i]->mutator.copyLayout(replicas[i]->current, layouts[i % layouts.size()]);
+      restartReplica(*replicas[i]);
+    }
+  }
+
+  void TemperingOpt::setInitMode(InitMode mode) {
+    // Replicas never restart, so only their starting designs change.
+    if (mode != InitMode::Greedy)
+      return;
+    for (auto &replica : replicas) {
+      replica->mutator.construct(replica->current, replica->evaluator, replica->rng);
+      restartReplica(*replica);
+    }
+  }
+
+  void TemperingOpt::saveCheckpoint(const std::string &path) const {
+    CheckpointWriter out(path, CheckpointKind::Tempering, settings);
+    out.value(static_cast<int>(replicas.size()));
+    out.value(nSinceExchange);
+    out.value(parity);
+    out.value(nSwapsProposed);
+    out.value(nSwapsAccepted);
+    out.random(rng);
+    out.value(scale);
+    writeSample(out, best);
+    for (auto &replica : replicas) {
+      out.value(replica->temperature);
+      out.random(replica->rng);
+      replica->mutator.save(out);
+      writeSample(out, replica->current);
+      writeSample(out, replica->best);
+      out.value(replica->nProposed);
+      out.value(replica->nAccepted);
+    }
+    out.commit();
+  }
+
+  void TemperingOpt::loadCheckpoint(const std::string &path) {
+    CheckpointReader in(path, CheckpointKind::Tempering, settings);
+    in.expect(in.value<int>() == static_cast<int>(replicas.size()), "replica count");
+    nSinceExchange = in.value<int>();
+    in.expect(nSinceExchange < exchangeInterval, "exchange interval");
+    parity = in.value<int>();
+    nSwapsProposed = in.value<std::uint64_t>();
+    nSwapsAccepted = in.value<std::uint64_t>();
+    in.random(rng);
+    scale = in.value<double>();
+    readSample(in, best);
+    auto &evaluator(replicas.front()->evaluator);
+    best.hash = cache.hashOf(best.state);
+    evaluator.run(best.state, best.value);
+    bestFitness = Opt::rawFitness(settings, best.value);
+    for (auto &replica : replicas) {
+      replica->temperature = in.value<double>();
+      in.random(replica->rng);
+      replica->mutator.load(in);
+      for (auto sample : {&replica->current, &replica->best}) {
+        readSample(in, *sample);
+        sample->hash = cache.hashOf(sample->state);
+        replica->evaluator.run(sample->state, sample->value);
+      }
+      replica->trial = replica->current;
+      // Only the stripped best is saved, so its fitness stands in for the one before stripping.
+      replica->bestFitness = Opt::rawFitness(settings, replica->best.value);
+      replica->newBest = false;
+      replica->nProposed = in.value<std::uint64_t>();
+      replica->nAccepted = in.value<std::uint64_t>();
+    }
+  }
+
+  void TemperingOpt::printProgress(std::ostream &out) const {
+    auto &coldest(*replicas.front());
+    out << " replicas=" << replicas.size()
+        << " swapRate=" << (nSwapsProposed ? static_cast<double>(nSwapsAccepted) / nSwapsProposed : 0.0)
+        << " coldAcceptRate=" << (coldest.nProposed ? static_cast<double>(coldest.nAccepted) / coldest.nProposed : 0.0);
+  }
+}
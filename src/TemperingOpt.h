@@ -0,0 +1,70 @@
+#ifndef _TEMPERING_OPT_H_
+#define _TEMPERING_OPT_H_
+#include "Engine.h"
+#include "WorkerPool.h"
+
+namespace Fission {
+  constexpr int defaultReplicas(8), defaultExchangeInterval(256);
+  // Temperatures of the coldest and hottest replica, relative to the best fitness found so far.
+  constexpr double temperingMin(1e-3), temperingMax(0.2);
+
+  // Replica exchange: Metropolis chains at geometrically spaced temperatures, run in parallel
+  // between exchanges. Every exchangeInterval steps neighbouring temperatures offer to swap
+  // states, so designs found by hot chains can cool down and stuck cold chains get out.
+  // Each replica has its own random stream, so results do not depend on the thread count.
+  class TemperingOpt : public Engine {
+    struct Replica {
+      Evaluator evaluator;
+      Mutator mutator;
+      std::mt19937 rng;
+      Sample current, best;
+      // Copy of current that proposals are tried on in place; its value is scratch.
+      Sample trial;
+      Mutator::Mutation mutation;
+      // bestFitness is that of best as found, before Opt-style pruning of its invalid tiles;
+      // newBest marks a best that step has not pruned and compared yet.
+      double temperature, bestFitness;
+      bool newBest;
+      std::uint64_t nProposed, nAccepted;
+      Replica(const Settings &settings, const TranspositionTable &cache, std::uint32_t seed);
+    };
+
+    const Settings &settings;
+    TranspositionTable cache;
+    std::vector<std::unique_ptr<Replica>> replicas;
+    int exchangeInterval, nSinceExchange, parity;
+    std::uint64_t nSwapsProposed, nSwapsAccepted;
+    std::mt19937 rng;
+    Sample best;
+    double bestFitness, scale;
+    WorkerPool pool;
+
+    // Fitness with the net heat of infeasible designs charged against it, as in Opt.
+    double penalizedFitness(const Evaluation &x) const;
+    void runReplica(int replica, int nSteps);
+    void exchange();
+    void updateTemperatures(double reference);
+    // Evaluates a replica whose current design was just replaced; it becomes the replica's best if better.
+    void restartReplica(Replica &replica);
+  public:
+    TemperingOpt(const Settings &settings, int nReplicas = defaultReplicas, int nThreads = 1,
+      int cacheEntries = defaultCacheEntries, int exchangeInterval = defaultExchangeInterval);
+    // One step proposes one mutation in every replica.
+    void step(int nSteps) override;
+    void setDifferentialCheck(bool enabled) override;
+    void setBackend(Backend backend) override;
+    // Replica i starts from layout i, cycling through them when there are more replicas.
+    void setInitialLayouts(const std::vector<State> &layouts) override;
+    void setInitMode(InitMode mode) override;
+    const Sample &getBest() const override { return best; }
+    double getBestFitness() const override { return bestFitness; }
+    std::uint64_t getCacheHits() const override { return cache.getHits(); }
+    std::uint64_t getCacheMisses() const override { return cache.getMisses(); }
+    // Swap acceptance between neighbouring temperatures and move acceptance of the coldest chain.
+    void printProgress(std::ostream &out) const override;
+    void saveCheckpoint(const std::string &path) const override;
+    void loadCheckpoint(const std::string &path) override;
+  };
+}
+
+#endif
@@ -0,0 +1,73 @@
+#include "WorkerPool.h"
+#include <utility>
+
+namespace Fission {
+  WorkerPool::WorkerPool(int nThreads)
+    :generation(), nTasks(), nextTask(), nBusy(), stopping() {
+    for (int i(1); i < nThreads; ++i)
+      workers.emplace_back(&WorkerPool::work, this);
+  }
+
+  WorkerPool::~WorkerPool() {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      stopping = true;
+    }
+    start.notify_all();
+    for (auto &worker : workers)
+      worker.join();
+  }
+
+  void WorkerPool::work() {
+    int seen{};
+    while (true) {
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        start.wait(lock, [&] { return stopping || generation != seen; });
+        if (stopping)
+          return;
+        seen = generation;
+        ++nBusy;
+      }
+      drain();
+      std::lock_guard<std::mutex> lock(mutex);
+      if (!--nBusy)
+        done.notify_all();
+    }
+  }
+
+  void WorkerPool::drain() {
+    while (true) {
+      int i;
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (nextTask == nTasks)
+          return;
+        i = nextTask++;
+      }
+      try {
+        task(i);
+      } catch (...) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!failure)
+          failure = std::current_exception();
+      }
+    }
+  }
+
+  void WorkerPool::run(int nTasks, std::function<void(int)> task) {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      this->task = std::move(task);
+      this->nTasks = nTasks;
+      nextTask = 0;
+      ++generation;
+    }
+    start.notify_all();
+    drain();
+    std::unique_lock<std::mutex> lock(mutex);
+    done.wait(lock, [&] { return !nBusy; });
+    if (failure)
+      std::rethrow_exception(std::exchange(failure, nullptr));
+  }
+}
@@ -0,0 +1,33 @@
+#ifndef _WORKER_POOL_H_
+#define _WORKER_POOL_H_
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Fission {
+  // Fixed set of threads that run numbered tasks on request; the calling thread takes part too.
+  class WorkerPool {
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable start, done;
+    std::function<void(int)> task;
+    int generation, nTasks, nextTask, nBusy;
+    bool stopping;
+    // First exception thrown by a task, rethrown by run.
+    std::exception_ptr failure;
+
+    void work();
+    void drain();
+  public:
+    explicit WorkerPool(int nThreads);
+    ~WorkerPool();
+    int getNThreads() const { return static_cast<int>(workers.size()) + 1; }
+    // Calls task(0) ... task(nTasks - 1), spread over the threads; returns once all are done.
+    void run(int nTasks, std::function<void(int)> task);
+  };
+}
+
+#endif